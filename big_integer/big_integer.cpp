@@ -1,92 +1,2484 @@
 #include "big_integer.hpp"
+#include "limbs.hpp"
 
-const int kName = 10;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-BigInt::BigInt() {}
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define BIG_INTEGER_AVX2 1
+#endif
+
+// Makes the LimbVectors created on this thread while it lives belong to
+// arena (nullptr: the heap), and lets vectors of that arena grow in it.
+// Every operation on BigInt values opens one for the arena of its operands,
+// so its result and its temporaries share that arena. Pool workers never
+// have one, which keeps each arena on a single thread.
+class ArenaScope {
+ public:
+  explicit ArenaScope(LimbArena* arena)
+      : previous_(LimbVector::current_arena_) {
+    LimbVector::current_arena_ = arena;
+  }
+  explicit ArenaScope(const LimbVector& x) : ArenaScope(x.arena()) {}
+  // The arena of lhs, or of rhs if lhs is on the heap.
+  ArenaScope(const LimbVector& lhs, const LimbVector& rhs)
+      : ArenaScope(lhs.arena() != nullptr ? lhs.arena() : rhs.arena()) {}
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+  ~ArenaScope() { LimbVector::current_arena_ = previous_; }
+
+ private:
+  LimbArena* previous_;
+};
+
+namespace {
+
+using Uint128 = unsigned __int128;
+
+const int kLimbBits = 64;
+// Largest power of ten that fits in one limb.
+const uint64_t kDecimalBase = 10000000000000000000ULL;
+const int kDecimalDigits = 19;
+
+// r[0, n) = a[0, n) + b[0, n) + carry, returning the carry out. r may alias
+// a or b.
+uint64_t AddLimbsScalar(uint64_t* r, const uint64_t* a, const uint64_t* b,
+                        size_t n, uint64_t carry) {
+  for (size_t i = 0; i < n; ++i) {
+    Uint128 cur = static_cast<Uint128>(a[i]) + b[i] + carry;
+    r[i] = static_cast<uint64_t>(cur);
+    carry = static_cast<uint64_t>(cur >> kLimbBits);
+  }
+  return carry;
+}
+
+// r[0, n) = a[0, n) - b[0, n) - borrow, returning the borrow out. r may alias
+// a or b.
+uint64_t SubLimbsScalar(uint64_t* r, const uint64_t* a, const uint64_t* b,
+                        size_t n, uint64_t borrow) {
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t diff = a[i] - b[i];
+    uint64_t next = (a[i] < b[i] || diff < borrow) ? 1 : 0;
+    r[i] = diff - borrow;
+    borrow = next;
+  }
+  return borrow;
+}
+
+#ifdef BIG_INTEGER_AVX2
+// kLaneMask[m] has 1 in lane i exactly when bit i of m is set.
+alignas(32) const uint64_t kLaneMask[16][4] = {
+    {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {1, 1, 0, 0},
+    {0, 0, 1, 0}, {1, 0, 1, 0}, {0, 1, 1, 0}, {1, 1, 1, 0},
+    {0, 0, 0, 1}, {1, 0, 0, 1}, {0, 1, 0, 1}, {1, 1, 0, 1},
+    {0, 0, 1, 1}, {1, 0, 1, 1}, {0, 1, 1, 1}, {1, 1, 1, 1}};
+
+// Four limbs per step without a serial carry chain. Every lane either
+// generates a carry (its sum wrapped), propagates one (its sum is all ones)
+// or neither, so adding the 4-bit generate and propagate masks yields the
+// carry into each lane and out of the block, as in a carry-lookahead adder.
+__attribute__((target("avx2"))) uint64_t AddLimbsAvx2(
+    uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n,
+    uint64_t carry) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  const __m256i ones = _mm256_set1_epi64x(-1);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i sum = _mm256_add_epi64(x, y);
+    // Unsigned sum < x, through signed compares of sign-flipped values.
+    __m256i wrapped = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign),
+                                         _mm256_xor_si256(sum, sign));
+    __m256i full = _mm256_cmpeq_epi64(sum, ones);
+    uint64_t generate = _mm256_movemask_pd(_mm256_castsi256_pd(wrapped));
+    uint64_t propagate = _mm256_movemask_pd(_mm256_castsi256_pd(full));
+    uint64_t chain = (generate << 1) + carry + propagate;
+    __m256i in = _mm256_load_si256(reinterpret_cast<const __m256i*>(
+        kLaneMask[(chain ^ propagate) & 15]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i),
+                        _mm256_add_epi64(sum, in));
+    carry = chain >> 4;
+  }
+  return AddLimbsScalar(r + i, a + i, b + i, n - i, carry);
+}
+
+// Same scheme for borrows: a lane generates one when a < b and propagates
+// one when a == b.
+__attribute__((target("avx2"))) uint64_t SubLimbsAvx2(
+    uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n,
+    uint64_t borrow) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i below = _mm256_cmpgt_epi64(_mm256_xor_si256(y, sign),
+                                       _mm256_xor_si256(x, sign));
+    __m256i equal = _mm256_cmpeq_epi64(x, y);
+    uint64_t generate = _mm256_movemask_pd(_mm256_castsi256_pd(below));
+    uint64_t propagate = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+    uint64_t chain = (generate << 1) + borrow + propagate;
+    __m256i in = _mm256_load_si256(reinterpret_cast<const __m256i*>(
+        kLaneMask[(chain ^ propagate) & 15]));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(r + i),
+        _mm256_sub_epi64(_mm256_sub_epi64(x, y), in));
+    borrow = chain >> 4;
+  }
+  return SubLimbsScalar(r + i, a + i, b + i, n - i, borrow);
+}
+#endif
+
+#ifdef BIG_INTEGER_AVX2
+// Checked once per kernel, on first use.
+bool HasAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+}
+#endif
+
+// Runs shorter than this stay scalar: the vector loop needs a few blocks to
+// pay off.
+const size_t kVectorLimbs = 8;
+
+// v = floor((B^2 - 1) / d) - B for d with its top bit set, the reciprocal
+// of Moller and Granlund's "Improved division by invariant integers".
+uint64_t LimbReciprocal(uint64_t d) {
+  return static_cast<uint64_t>(
+      ((static_cast<Uint128>(~d) << kLimbBits) | ~uint64_t{0}) / d);
+}
+
+// (u1 * B + u0) / d for d with its top bit set and u1 < d, given v =
+// LimbReciprocal(d): one multiplication and two rare corrections instead of
+// a 128-bit hardware division. Sets *rem to the remainder.
+inline uint64_t DivRemPreinv(uint64_t u1, uint64_t u0, uint64_t d, uint64_t v,
+                             uint64_t* rem) {
+  Uint128 q = static_cast<Uint128>(v) * u1 +
+              ((static_cast<Uint128>(u1) << kLimbBits) | u0);
+  uint64_t q1 = static_cast<uint64_t>(q >> kLimbBits) + 1;
+  uint64_t r = u0 - q1 * d;
+  if (r > static_cast<uint64_t>(q)) {
+    --q1;
+    r += d;
+  }
+  if (r >= d) {
+    ++q1;
+    r -= d;
+  }
+  *rem = r;
+  return q1;
+}
+
+// Shared loop of DivRem1 and Mod1: divides a << shift by d = b << shift
+// from the top limb down, writing quotient limbs to q unless it is null.
+uint64_t DivRemNormalized(uint64_t* q, const uint64_t* a, size_t n,
+                          uint64_t b) {
+  int shift = __builtin_clzll(b);
+  uint64_t d = b << shift;
+  uint64_t v = LimbReciprocal(d);
+  uint64_t rem = 0;
+  if (shift != 0 && n > 0) {
+    rem = a[n - 1] >> (kLimbBits - shift);
+  }
+  for (size_t i = n; i-- > 0;) {
+    uint64_t limb = a[i] << shift;
+    if (shift != 0 && i > 0) {
+      limb |= a[i - 1] >> (kLimbBits - shift);
+    }
+    uint64_t digit = DivRemPreinv(rem, limb, d, v, &rem);
+    if (q != nullptr) {
+      q[i] = digit;
+    }
+  }
+  return rem >> shift;
+}
+
+}  // namespace
+
+namespace limbs {
+
+uint64_t AddN(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+#ifdef BIG_INTEGER_AVX2
+  static const bool avx2 = HasAvx2();
+  if (avx2 && n >= kVectorLimbs) {
+    return AddLimbsAvx2(r, a, b, n, 0);
+  }
+#endif
+  return AddLimbsScalar(r, a, b, n, 0);
+}
+
+uint64_t Add(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+             size_t bn) {
+  uint64_t carry = AddN(r, a, b, bn);
+  return Add1(r + bn, a + bn, an - bn, carry);
+}
+
+uint64_t Add1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+  size_t i = 0;
+  for (; i < n && b != 0; ++i) {
+    uint64_t sum = a[i] + b;
+    b = sum < b ? 1 : 0;
+    r[i] = sum;
+  }
+  if (r != a) {
+    std::copy(a + i, a + n, r + i);
+  }
+  return b;
+}
+
+uint64_t SubN(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+#ifdef BIG_INTEGER_AVX2
+  static const bool avx2 = HasAvx2();
+  if (avx2 && n >= kVectorLimbs) {
+    return SubLimbsAvx2(r, a, b, n, 0);
+  }
+#endif
+  return SubLimbsScalar(r, a, b, n, 0);
+}
+
+uint64_t Sub(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+             size_t bn) {
+  uint64_t borrow = SubN(r, a, b, bn);
+  return Sub1(r + bn, a + bn, an - bn, borrow);
+}
+
+uint64_t Sub1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+  size_t i = 0;
+  for (; i < n && b != 0; ++i) {
+    uint64_t next = a[i] < b ? 1 : 0;
+    r[i] = a[i] - b;
+    b = next;
+  }
+  if (r != a) {
+    std::copy(a + i, a + n, r + i);
+  }
+  return b;
+}
+
+int Compare(const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+  an = Normalize(a, an);
+  bn = Normalize(b, bn);
+  if (an != bn) {
+    return an < bn ? -1 : 1;
+  }
+  for (size_t i = an; i-- > 0;) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+size_t Normalize(const uint64_t* a, size_t n) {
+  while (n > 0 && a[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
+
+uint64_t Mul1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+  uint64_t carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    Uint128 cur = static_cast<Uint128>(a[i]) * b + carry;
+    r[i] = static_cast<uint64_t>(cur);
+    carry = static_cast<uint64_t>(cur >> kLimbBits);
+  }
+  return carry;
+}
+
+uint64_t AddMul1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+  uint64_t carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    Uint128 cur = static_cast<Uint128>(a[i]) * b + r[i] + carry;
+    r[i] = static_cast<uint64_t>(cur);
+    carry = static_cast<uint64_t>(cur >> kLimbBits);
+  }
+  return carry;
+}
+
+uint64_t SubMul1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+  uint64_t borrow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    Uint128 prod = static_cast<Uint128>(a[i]) * b + borrow;
+    uint64_t low = static_cast<uint64_t>(prod);
+    // The high half is at most 2^64 - 2, so the extra borrow fits.
+    borrow = static_cast<uint64_t>(prod >> kLimbBits) + (r[i] < low ? 1 : 0);
+    r[i] -= low;
+  }
+  return borrow;
+}
+
+uint64_t DivRem1(uint64_t* q, const uint64_t* a, size_t n, uint64_t b) {
+  return DivRemNormalized(q, a, n, b);
+}
+
+uint64_t Mod1(const uint64_t* a, size_t n, uint64_t b) {
+  return DivRemNormalized(nullptr, a, n, b);
+}
+
+}  // namespace limbs
+
+namespace {
+
+std::atomic<size_t> limb_allocations(0);
+
+// Magnitudes are normalized, so the lengths decide unless they are equal.
+int CompareAbs(const LimbVector& lhs, const LimbVector& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return lhs.size() < rhs.size() ? -1 : 1;
+  }
+  return limbs::Compare(lhs.data(), lhs.size(), rhs.data(), rhs.size());
+}
+
+// lhs -= rhs for magnitudes with lhs >= rhs.
+void SubAbs(LimbVector& lhs, const LimbVector& rhs) {
+  limbs::Sub(lhs.data(), lhs.data(), lhs.size(), rhs.data(), rhs.size());
+  lhs.resize(limbs::Normalize(lhs.data(), lhs.size()));
+}
+
+void MulAddSmall(LimbVector& x, uint64_t mul, uint64_t add) {
+  for (auto& limb : x) {
+    Uint128 cur = static_cast<Uint128>(limb) * mul + add;
+    limb = static_cast<uint64_t>(cur);
+    add = static_cast<uint64_t>(cur >> kLimbBits);
+  }
+  if (add != 0) {
+    x.push_back(add);
+  }
+}
+
+uint64_t DivRemSmall(LimbVector& x, uint64_t div) {
+  uint64_t rem = limbs::DivRem1(x.data(), x.data(), x.size(), div);
+  while (!x.empty() && x.back() == 0) {
+    x.pop_back();
+  }
+  return rem;
+}
+
+// Cut-over sizes in limbs of the shorter operand, measured on x86-64 (gcc -O2):
+// Karatsuba overtakes schoolbook around 46 limbs and Toom-3 overtakes
+// Karatsuba between 400 and 600 limbs.
+const size_t kKaratsubaThreshold = 48;
+const size_t kToom3Threshold = 500;
+// Squares leave schoolbook later, since it does half the work there; the
+// Toom-3 crossover did not move measurably.
+const size_t kSqrKaratsubaThreshold = 60;
+// Products this short are formed on the stack, so a result that fits in the
+// inline limbs of a BigInt never touches the heap.
+const size_t kSmallProductLimbs = 2 * LimbVector::kInlineLimbs;
+// Algorithm D keeps its normalized operands on the stack up to this size.
+const size_t kStackDivisionLimbs = 16;
+
+void IncrementAbs(LimbVector& x) {
+  if (limbs::Add1(x.data(), x.data(), x.size(), 1) != 0) {
+    x.push_back(1);
+  }
+}
+
+// Requires x != 0.
+void DecrementAbs(LimbVector& x) {
+  limbs::Sub1(x.data(), x.data(), x.size(), 1);
+  if (x.back() == 0) {
+    x.pop_back();
+  }
+}
+
+// A task of a TaskGroup. Whoever claims it first runs it: a pool worker or
+// the thread waiting for the group.
+struct PoolTask {
+  std::function<void()> body;
+  std::atomic<bool> claimed{false};
+
+  void TryRun() {
+    if (!claimed.exchange(true)) {
+      body();
+    }
+  }
+};
+
+// Worker threads shared by all parallel loops. SetThreadCount starts them
+// once, and they are reused by every later product and conversion.
+class WorkerPool {
+ public:
+  static WorkerPool& Instance() {
+    static WorkerPool pool;
+    return pool;
+  }
+  ~WorkerPool() { Resize(0); }
+
+  // Stops the current workers and starts count new ones. The queue only
+  // holds tasks that their groups also run themselves, so it is dropped.
+  void Resize(size_t count) {
+    std::lock_guard<std::mutex> resize_lock(resize_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.clear();
+    stop_ = false;
+    for (size_t i = 0; i < count; ++i) {
+      workers_.emplace_back([this] { Work(); });
+    }
+  }
+  void Push(std::shared_ptr<PoolTask> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    ready_.notify_one();
+  }
+
+ private:
+  WorkerPool() {}
+
+  void Work() {
+    while (true) {
+      std::shared_ptr<PoolTask> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (stop_) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task->TryRun();
+    }
+  }
+
+  std::mutex resize_mutex_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::shared_ptr<PoolTask>> tasks_;
+  std::vector<std::thread> workers_;
+  bool stop_ = false;
+};
+
+// Tasks queued on the WorkerPool by one parallel loop.
+class TaskGroup {
+ public:
+  void Run(std::function<void()> task) {
+    auto entry = std::make_shared<PoolTask>();
+    entry->body = [this, task = std::move(task)] {
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_.notify_all();
+      }
+    };
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++pending_;
+    }
+    tasks_.push_back(entry);
+    WorkerPool::Instance().Push(std::move(entry));
+  }
+  // Returns once every task has finished, and rethrows the first exception
+  // one of them threw. Tasks no worker has claimed yet run on the calling
+  // thread, so the loop finishes even with no idle workers. Tasks of other
+  // groups never do: they could block on a lock the caller holds.
+  void Wait() {
+    for (auto& task : tasks_) {
+      task->TryRun();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  std::vector<std::shared_ptr<PoolTask>> tasks_;
+  size_t pending_ = 0;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  std::exception_ptr error_;
+};
+
+// Products whose shorter operand has at least this many limbs split their
+// subproducts across threads. Such a product takes a few hundred
+// microseconds, well above the cost of handing a task to a worker.
+const size_t kParallelMulLimbs = 1000;
+
+// Runs body(begin, end) on up to threads consecutive chunks of [0, count),
+// all but the last one as tasks on the WorkerPool.
+template <typename Body>
+void ParallelFor(size_t count, size_t threads, const Body& body) {
+  size_t chunks = std::max<size_t>(std::min(threads, count), 1);
+  if (chunks == 1) {
+    body(0, count);
+    return;
+  }
+  TaskGroup group;
+  for (size_t i = 0; i + 1 < chunks; ++i) {
+    group.Run([&body, count, chunks, i] {
+      body(count * i / chunks, count * (i + 1) / chunks);
+    });
+  }
+  try {
+    body(count * (chunks - 1) / chunks, count);
+  } catch (...) {
+    group.Wait();
+    throw;
+  }
+  group.Wait();
+}
+
+// r[0, an + bn) = a * b, using up to threads threads.
+void MulAbs(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+            size_t bn, size_t threads = 1);
+
+void MulSchoolbook(uint64_t* r, const uint64_t* a, size_t an,
+                   const uint64_t* b, size_t bn) {
+  std::fill(r, r + an + bn, 0);
+  for (size_t i = 0; i < an; i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < bn; j++) {
+      Uint128 cur = static_cast<Uint128>(a[i]) * b[j] + r[i + j] + carry;
+      r[i + j] = static_cast<uint64_t>(cur);
+      carry = static_cast<uint64_t>(cur >> kLimbBits);
+    }
+    r[i + bn] = carry;
+  }
+}
+
+// r[0, 2n) = a^2. Each cross product a[i] * a[j], i < j, is formed once and
+// doubled, so this takes about half the multiplications of MulSchoolbook.
+void SqrSchoolbook(uint64_t* r, const uint64_t* a, size_t n) {
+  std::fill(r, r + 2 * n, 0);
+  for (size_t i = 0; i + 1 < n; i++) {
+    uint64_t carry = 0;
+    for (size_t j = i + 1; j < n; j++) {
+      Uint128 cur = static_cast<Uint128>(a[i]) * a[j] + r[i + j] + carry;
+      r[i + j] = static_cast<uint64_t>(cur);
+      carry = static_cast<uint64_t>(cur >> kLimbBits);
+    }
+    r[i + n] = carry;
+  }
+  uint64_t shifted = 0;
+  uint64_t carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    Uint128 square = static_cast<Uint128>(a[i]) * a[i];
+    uint64_t lo = r[2 * i];
+    uint64_t hi = r[2 * i + 1];
+    Uint128 cur = static_cast<Uint128>((lo << 1) | shifted) +
+                  static_cast<uint64_t>(square) + carry;
+    r[2 * i] = static_cast<uint64_t>(cur);
+    cur = static_cast<Uint128>((hi << 1) | (lo >> (kLimbBits - 1))) +
+          static_cast<uint64_t>(square >> kLimbBits) +
+          static_cast<uint64_t>(cur >> kLimbBits);
+    r[2 * i + 1] = static_cast<uint64_t>(cur);
+    carry = static_cast<uint64_t>(cur >> kLimbBits);
+    shifted = hi >> (kLimbBits - 1);
+  }
+}
+
+// r[0, 2n) = a^2 from the squares of the halves and of their difference:
+// 2 * a0 * a1 = a0^2 + a1^2 - (a0 - a1)^2, which needs no carry limb.
+void SqrKaratsuba(uint64_t* r, const uint64_t* a, size_t n, size_t threads) {
+  size_t h = (n + 1) / 2;
+  LimbVector diff(a + h, a + n);
+  diff.resize(h, 0);
+  if (limbs::Compare(a, h, diff.data(), h) >= 0) {
+    limbs::SubN(diff.data(), a, diff.data(), h);
+  } else {
+    limbs::SubN(diff.data(), diff.data(), a, h);
+  }
+  LimbVector mid(2 * h);
+  size_t share = std::max<size_t>(threads / 3, 1);
+  ParallelFor(3, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0) {
+        MulAbs(r, a, h, a, h, share);
+      } else if (i == 1) {
+        MulAbs(r + 2 * h, a + h, n - h, a + h, n - h, share);
+      } else {
+        MulAbs(mid.data(), diff.data(), h, diff.data(), h, share);
+      }
+    }
+  });
+  LimbVector cross(r, r + 2 * h);
+  cross.push_back(limbs::Add(cross.data(), cross.data(), 2 * h, r + 2 * h,
+                             2 * (n - h)));
+  limbs::Sub(cross.data(), cross.data(), cross.size(), mid.data(), 2 * h);
+  limbs::Add(r + h, r + h, 2 * n - h, cross.data(),
+             limbs::Normalize(cross.data(), cross.size()));
+}
+
+// Requires an >= bn >= ceil(an / 2).
+void MulKaratsuba(uint64_t* r, const uint64_t* a, size_t an,
+                  const uint64_t* b, size_t bn, size_t threads) {
+  size_t h = (an + 1) / 2;
+  LimbVector sa(a, a + h);
+  LimbVector sb(b, b + h);
+  sa.push_back(limbs::Add(sa.data(), sa.data(), h, a + h, an - h));
+  sb.push_back(limbs::Add(sb.data(), sb.data(), h, b + h, bn - h));
+  LimbVector mid(2 * h + 2);
+  size_t share = std::max<size_t>(threads / 3, 1);
+  ParallelFor(3, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0) {
+        MulAbs(r, a, h, b, h, share);
+      } else if (i == 1) {
+        MulAbs(r + 2 * h, a + h, an - h, b + h, bn - h, share);
+      } else {
+        MulAbs(mid.data(), sa.data(), h + 1, sb.data(), h + 1, share);
+      }
+    }
+  });
+  limbs::Sub(mid.data(), mid.data(), mid.size(), r, 2 * h);
+  limbs::Sub(mid.data(), mid.data(), mid.size(), r + 2 * h, an + bn - 2 * h);
+  limbs::Add(r + h, r + h, an + bn - h, mid.data(),
+             limbs::Normalize(mid.data(), mid.size()));
+}
+
+// Signed value used for the Toom-3 evaluation and interpolation.
+struct SignedLimbs {
+  LimbVector abs;
+  bool neg = false;
+};
+
+SignedLimbs Piece(const uint64_t* a, size_t begin, size_t end) {
+  SignedLimbs res;
+  if (begin < end) {
+    res.abs.assign(a + begin, a + end);
+  }
+  while (!res.abs.empty() && res.abs.back() == 0) {
+    res.abs.pop_back();
+  }
+  return res;
+}
+
+// lhs += (negate ? -rhs : rhs).
+void AddSigned(SignedLimbs& lhs, const SignedLimbs& rhs, bool negate) {
+  bool rhs_neg = rhs.neg != negate;
+  if (lhs.neg == rhs_neg) {
+    size_t size = std::max(lhs.abs.size(), rhs.abs.size());
+    lhs.abs.resize(size + 1);
+    limbs::Add(lhs.abs.data(), lhs.abs.data(), size + 1, rhs.abs.data(),
+               rhs.abs.size());
+  } else if (CompareAbs(lhs.abs, rhs.abs) >= 0) {
+    SubAbs(lhs.abs, rhs.abs);
+  } else {
+    LimbVector diff = rhs.abs;
+    SubAbs(diff, lhs.abs);
+    lhs.abs.swap(diff);
+    lhs.neg = rhs_neg;
+  }
+  while (!lhs.abs.empty() && lhs.abs.back() == 0) {
+    lhs.abs.pop_back();
+  }
+  if (lhs.abs.empty()) {
+    lhs.neg = false;
+  }
+}
+
+void ShiftLeftOne(SignedLimbs& x) { MulAddSmall(x.abs, 2, 0); }
+
+void ShiftRightOne(SignedLimbs& x) {
+  for (size_t i = 0; i < x.abs.size(); ++i) {
+    x.abs[i] >>= 1;
+    if (i + 1 < x.abs.size()) {
+      x.abs[i] |= x.abs[i + 1] << (kLimbBits - 1);
+    }
+  }
+  if (!x.abs.empty() && x.abs.back() == 0) {
+    x.abs.pop_back();
+  }
+  if (x.abs.empty()) {
+    x.neg = false;
+  }
+}
+
+LimbVector MulVec(const LimbVector& lhs, const LimbVector& rhs,
+                  size_t threads = 1) {
+  LimbVector res;
+  if (lhs.empty() || rhs.empty()) {
+    return res;
+  }
+  res.resize(lhs.size() + rhs.size());
+  MulAbs(res.data(), lhs.data(), lhs.size(), rhs.data(), rhs.size(),
+         threads);
+  while (res.back() == 0) {
+    res.pop_back();
+  }
+  return res;
+}
+
+SignedLimbs MulSigned(const SignedLimbs& lhs, const SignedLimbs& rhs,
+                      size_t threads = 1) {
+  SignedLimbs res;
+  res.abs = MulVec(lhs.abs, rhs.abs, threads);
+  res.neg = !res.abs.empty() && lhs.neg != rhs.neg;
+  return res;
+}
+
+// Toom-Cook 3-way with Bodrato's evaluation points 0, 1, -1, -2, inf.
+// Requires an >= bn > 2 * ceil(an / 3).
+void MulToom3(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+              size_t bn, size_t threads) {
+  size_t k = (an + 2) / 3;
+  SignedLimbs a0 = Piece(a, 0, k);
+  SignedLimbs a1 = Piece(a, k, 2 * k);
+  SignedLimbs a2 = Piece(a, 2 * k, an);
+  SignedLimbs ap = a0;
+  AddSigned(ap, a2, false);
+  SignedLimbs a_one = ap;
+  AddSigned(a_one, a1, false);
+  SignedLimbs a_minus_one = ap;
+  AddSigned(a_minus_one, a1, true);
+  SignedLimbs a_minus_two = a_minus_one;
+  AddSigned(a_minus_two, a2, false);
+  ShiftLeftOne(a_minus_two);
+  AddSigned(a_minus_two, a0, true);
+
+  const SignedLimbs* lhs[] = {&a0, &a_one, &a_minus_one, &a_minus_two, &a2};
+  const SignedLimbs* rhs[] = {lhs[0], lhs[1], lhs[2], lhs[3], lhs[4]};
+  // A square evaluates its operand once; the pointwise products are squares
+  // too, which MulAbs recognizes.
+  SignedLimbs b0;
+  SignedLimbs b_one;
+  SignedLimbs b_minus_one;
+  SignedLimbs b_minus_two;
+  SignedLimbs b2;
+  if (a != b || an != bn) {
+    b0 = Piece(b, 0, k);
+    SignedLimbs b1 = Piece(b, k, 2 * k);
+    b2 = Piece(b, 2 * k, bn);
+    SignedLimbs bp = b0;
+    AddSigned(bp, b2, false);
+    b_one = bp;
+    AddSigned(b_one, b1, false);
+    b_minus_one = bp;
+    AddSigned(b_minus_one, b1, true);
+    b_minus_two = b_minus_one;
+    AddSigned(b_minus_two, b2, false);
+    ShiftLeftOne(b_minus_two);
+    AddSigned(b_minus_two, b0, true);
+    rhs[0] = &b0;
+    rhs[1] = &b_one;
+    rhs[2] = &b_minus_one;
+    rhs[3] = &b_minus_two;
+    rhs[4] = &b2;
+  }
+  SignedLimbs products[5];
+  size_t share = std::max<size_t>(threads / 5, 1);
+  ParallelFor(5, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      products[i] = MulSigned(*lhs[i], *rhs[i], share);
+    }
+  });
+  SignedLimbs& r0 = products[0];
+  SignedLimbs& r1 = products[1];
+  SignedLimbs& r_minus_one = products[2];
+  SignedLimbs& r3 = products[3];
+  SignedLimbs& r_inf = products[4];
+
+  AddSigned(r3, r1, true);
+  DivRemSmall(r3.abs, 3);
+  AddSigned(r1, r_minus_one, true);
+  ShiftRightOne(r1);
+  SignedLimbs r2 = r_minus_one;
+  AddSigned(r2, r0, true);
+  SignedLimbs half = r2;
+  AddSigned(half, r3, true);
+  ShiftRightOne(half);
+  r3 = std::move(half);
+  SignedLimbs r_inf_twice = r_inf;
+  ShiftLeftOne(r_inf_twice);
+  AddSigned(r3, r_inf_twice, false);
+  AddSigned(r2, r1, false);
+  AddSigned(r2, r_inf, true);
+  AddSigned(r1, r3, true);
+
+  std::fill(r, r + an + bn, 0);
+  const SignedLimbs* coeffs[] = {&r0, &r1, &r2, &r3, &r_inf};
+  for (size_t i = 0; i < 5; ++i) {
+    const LimbVector& coeff = coeffs[i]->abs;
+    limbs::Add(r + i * k, r + i * k, an + bn - i * k, coeff.data(),
+               coeff.size());
+  }
+}
+
+// Arithmetic modulo a prime p < 2^62 in Montgomery form (R = 2^64).
+class NttField {
+ public:
+  explicit NttField(uint64_t mod) : mod_(mod) {
+    uint64_t inv = mod;
+    for (int i = 0; i < 5; ++i) {
+      inv *= 2 - mod * inv;
+    }
+    neg_inv_ = 0 - inv;
+    uint64_t r = (0 - mod) % mod;
+    r2_ = static_cast<uint64_t>(static_cast<Uint128>(r) * r % mod);
+  }
+
+  uint64_t Mod() const { return mod_; }
+
+  // a * b / R mod p. Valid for any a < 2^64 as long as b < p.
+  uint64_t Mul(uint64_t a, uint64_t b) const {
+    Uint128 t = static_cast<Uint128>(a) * b;
+    uint64_t m = static_cast<uint64_t>(t) * neg_inv_;
+    uint64_t res = static_cast<uint64_t>(
+        (t + static_cast<Uint128>(m) * mod_) >> kLimbBits);
+    return res >= mod_ ? res - mod_ : res;
+  }
+  uint64_t Add(uint64_t a, uint64_t b) const {
+    uint64_t res = a + b;
+    return res >= mod_ ? res - mod_ : res;
+  }
+  uint64_t Sub(uint64_t a, uint64_t b) const {
+    return a >= b ? a - b : a + mod_ - b;
+  }
+  uint64_t ToField(uint64_t x) const { return Mul(x, r2_); }
+  uint64_t FromField(uint64_t x) const { return Mul(x, 1); }
+  uint64_t Pow(uint64_t base, uint64_t exp) const {
+    uint64_t res = ToField(1);
+    while (exp != 0) {
+      if ((exp & 1) != 0) {
+        res = Mul(res, base);
+      }
+      base = Mul(base, base);
+      exp >>= 1;
+    }
+    return res;
+  }
+
+ private:
+  uint64_t mod_;
+  uint64_t neg_inv_;
+  uint64_t r2_;
+};
+
+// Primes c * 2^k + 1 with a generator of the multiplicative group. Their
+// product exceeds 2^184, while a convolution of 64-bit limbs with fewer
+// than 2^54 terms stays below 2^182, so CRT recovers it exactly.
+const uint64_t kNttPrimes[3] = {4179340454199820289ULL, 2485986994308513793ULL,
+                                3188548536178311169ULL};
+const uint64_t kNttGenerators[3] = {3, 5, 7};
+// Operands with at least this many limbs (the shorter one) use the NTT.
+// Measured against Toom-3: the crossover is 4000-6000 limbs depending on how
+// much the transform length gets padded up to a power of two.
+const size_t kNttThreshold = 5000;
+
+// Twiddle factors laid out per butterfly level: roots[len + j] = w^j where w
+// is a primitive (2 * len)-th root of unity, for every power of two len < n.
+LimbVector NttRoots(uint64_t root, size_t n, const NttField& field) {
+  LimbVector roots(std::max<size_t>(n, 2));
+  for (size_t j = 0; j < n / 2; ++j) {
+    roots[n / 2 + j] =
+        j == 0 ? field.ToField(1) : field.Mul(roots[n / 2 + j - 1], root);
+  }
+  for (size_t len = n / 4; len >= 1; len /= 2) {
+    for (size_t j = 0; j < len; ++j) {
+      roots[len + j] = roots[2 * len + 2 * j];
+    }
+  }
+  return roots;
+}
+
+// Gentleman-Sande forward transform of a[0, n). The output is in bit-reversed
+// order, which InverseNtt consumes directly. The field is taken by value so
+// that stores into a cannot alias it.
+void ForwardNtt(uint64_t* a, size_t n, const uint64_t* roots,
+                NttField field) {
+  for (size_t len = n / 2; len >= 1; len /= 2) {
+    const uint64_t* twiddles = roots + len;
+    for (size_t i = 0; i < n; i += 2 * len) {
+      uint64_t* lo = a + i;
+      uint64_t* hi = lo + len;
+      for (size_t j = 0; j < len; ++j) {
+        uint64_t u = lo[j];
+        uint64_t v = hi[j];
+        lo[j] = field.Add(u, v);
+        hi[j] = field.Mul(field.Sub(u, v), twiddles[j]);
+      }
+    }
+  }
+}
+
+// Cooley-Tukey inverse transform of a[0, n) from bit-reversed order, without
+// the 1/n scaling.
+void InverseNtt(uint64_t* a, size_t n, const uint64_t* roots,
+                NttField field) {
+  for (size_t len = 1; len < n; len *= 2) {
+    const uint64_t* twiddles = roots + len;
+    for (size_t i = 0; i < n; i += 2 * len) {
+      uint64_t* lo = a + i;
+      uint64_t* hi = lo + len;
+      for (size_t j = 0; j < len; ++j) {
+        uint64_t u = lo[j];
+        uint64_t v = field.Mul(hi[j], twiddles[j]);
+        lo[j] = field.Add(u, v);
+        hi[j] = field.Sub(u, v);
+      }
+    }
+  }
+}
+
+// Transforms shorter than this are not split across threads.
+const size_t kParallelNttLength = 1 << 13;
+
+// ForwardNtt on up to threads threads. After the first level the two halves
+// are independent transforms, so each gets half of the threads.
+void ParallelForwardNtt(uint64_t* a, size_t n, const uint64_t* roots,
+                        const NttField& field, size_t threads) {
+  if (threads <= 1 || n < kParallelNttLength) {
+    ForwardNtt(a, n, roots, field);
+    return;
+  }
+  size_t half = n / 2;
+  const uint64_t* twiddles = roots + half;
+  ParallelFor(half, threads, [&](size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      uint64_t u = a[j];
+      uint64_t v = a[j + half];
+      a[j] = field.Add(u, v);
+      a[j + half] = field.Mul(field.Sub(u, v), twiddles[j]);
+    }
+  });
+  ParallelFor(2, 2, [&](size_t begin, size_t) {
+    ParallelForwardNtt(a + begin * half, half, roots, field,
+                       begin == 0 ? threads / 2 : threads - threads / 2);
+  });
+}
+
+// InverseNtt on up to threads threads: the halves first, then the last level.
+void ParallelInverseNtt(uint64_t* a, size_t n, const uint64_t* roots,
+                        const NttField& field, size_t threads) {
+  if (threads <= 1 || n < kParallelNttLength) {
+    InverseNtt(a, n, roots, field);
+    return;
+  }
+  size_t half = n / 2;
+  ParallelFor(2, 2, [&](size_t begin, size_t) {
+    ParallelInverseNtt(a + begin * half, half, roots, field,
+                       begin == 0 ? threads / 2 : threads - threads / 2);
+  });
+  const uint64_t* twiddles = roots + half;
+  ParallelFor(half, threads, [&](size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      uint64_t u = a[j];
+      uint64_t v = field.Mul(a[j + half], twiddles[j]);
+      a[j] = field.Add(u, v);
+      a[j + half] = field.Sub(u, v);
+    }
+  });
+}
+
+// Cyclic convolution of a and b modulo kNttPrimes[index], in normal form.
+LimbVector ConvolveModPrime(const uint64_t* a, size_t an, const uint64_t* b,
+                            size_t bn, size_t n, size_t index,
+                            size_t threads) {
+  NttField field(kNttPrimes[index]);
+  uint64_t mod = field.Mod();
+  uint64_t root = field.Pow(field.ToField(kNttGenerators[index]),
+                            (mod - 1) / n);
+  LimbVector roots = NttRoots(root, n, field);
+  // A square needs only one forward transform.
+  bool square = a == b && an == bn;
+  LimbVector fa(n, 0);
+  LimbVector fb(square ? 0 : n, 0);
+  ParallelFor(square ? 1 : 2, threads, [&](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      LimbVector& f = k == 0 ? fa : fb;
+      const uint64_t* src = k == 0 ? a : b;
+      size_t len = k == 0 ? an : bn;
+      for (size_t i = 0; i < len; ++i) {
+        f[i] = field.ToField(src[i]);
+      }
+      ParallelForwardNtt(f.data(), n, roots.data(), field,
+                         std::max<size_t>(threads / 2, 1));
+    }
+  });
+  ParallelFor(n, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      fa[i] = field.Mul(fa[i], square ? fa[i] : fb[i]);
+    }
+  });
+  roots = NttRoots(field.Pow(root, mod - 2), n, field);
+  ParallelInverseNtt(fa.data(), n, roots.data(), field, threads);
+  // Mul by n^-1 in field form leaves the result in normal form.
+  uint64_t inv_n = field.Pow(field.ToField(n), mod - 2);
+  ParallelFor(n, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      fa[i] = field.FromField(field.Mul(fa[i], inv_n));
+    }
+  });
+  return fa;
+}
+
+// Three-prime NTT multiplication with Garner's CRT reconstruction.
+void MulNtt(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+            size_t bn, size_t threads) {
+  size_t n = 1;
+  while (n < an + bn) {
+    n *= 2;
+  }
+  LimbVector res[3];
+  ParallelFor(3, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      res[i] = ConvolveModPrime(a, an, b, bn, n, i,
+                                std::max<size_t>(threads / 3, 1));
+    }
+  });
+
+  const uint64_t p0 = kNttPrimes[0];
+  const uint64_t p1 = kNttPrimes[1];
+  const uint64_t p2 = kNttPrimes[2];
+  NttField f1(p1);
+  NttField f2(p2);
+  // Constants in field form, so f.Mul(x, c) yields x * c mod p in normal form.
+  uint64_t inv_p0 = f1.Pow(f1.ToField(p0), p1 - 2);
+  Uint128 p0p1 = static_cast<Uint128>(p0) * p1;
+  uint64_t p0p1_mod = static_cast<uint64_t>(p0p1 % p2);
+  uint64_t inv_p0p1 = f2.Pow(f2.ToField(p0p1_mod), p2 - 2);
+  uint64_t p0_field = f2.ToField(p0);
+  uint64_t p0p1_lo = static_cast<uint64_t>(p0p1);
+  uint64_t p0p1_hi = static_cast<uint64_t>(p0p1 >> kLimbBits);
+
+  // Garner's mixed-radix digits t1 and t2 replace the residues mod p1 and
+  // p2; only the carry propagation below is sequential.
+  ParallelFor(an + bn, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      uint64_t r0 = res[0][i];
+      uint64_t t1 = f1.Mul(f1.Sub(res[1][i], r0 % p1), inv_p0);
+      uint64_t x_mod = f2.Add(r0 % p2, f2.Mul(t1, p0_field));
+      res[1][i] = t1;
+      res[2][i] = f2.Mul(f2.Sub(res[2][i], x_mod), inv_p0p1);
+    }
+  });
+  uint64_t carry0 = 0;
+  uint64_t carry1 = 0;
+  for (size_t i = 0; i < an + bn; ++i) {
+    uint64_t r0 = res[0][i];
+    uint64_t t1 = res[1][i];
+    uint64_t t2 = res[2][i];
+    // value = r0 + p0 * t1 + p0p1 * t2, up to three limbs.
+    Uint128 low = static_cast<Uint128>(p0) * t1 + r0;
+    Uint128 mid = static_cast<Uint128>(p0p1_lo) * t2;
+    Uint128 high = static_cast<Uint128>(p0p1_hi) * t2;
+    Uint128 acc = static_cast<Uint128>(static_cast<uint64_t>(low)) +
+                  static_cast<uint64_t>(mid) + carry0;
+    r[i] = static_cast<uint64_t>(acc);
+    acc = (acc >> kLimbBits) + (low >> kLimbBits) + (mid >> kLimbBits) +
+          static_cast<uint64_t>(high) + carry1;
+    carry0 = static_cast<uint64_t>(acc);
+    carry1 = static_cast<uint64_t>(acc >> kLimbBits) +
+             static_cast<uint64_t>(high >> kLimbBits);
+  }
+}
+
+// Knuth's Algorithm D. Requires an >= bn >= 2 and b[bn - 1] != 0; writes
+// q[0, an - bn + 1) and r[0, bn).
+void DivModKnuth(const uint64_t* a, size_t an, const uint64_t* b, size_t bn,
+               uint64_t* q, uint64_t* r) {
+  int shift = __builtin_clzll(b[bn - 1]);
+  uint64_t stack[kStackDivisionLimbs];
+  LimbVector heap;
+  uint64_t* un = stack;
+  if (an + 1 + bn > kStackDivisionLimbs) {
+    heap.resize(an + 1 + bn);
+    un = heap.data();
+  }
+  uint64_t* vn = un + an + 1;
+  for (size_t i = bn; i-- > 0;) {
+    vn[i] = b[i] << shift;
+    if (shift != 0 && i > 0) {
+      vn[i] |= b[i - 1] >> (kLimbBits - shift);
+    }
+  }
+  un[an] = shift != 0 ? a[an - 1] >> (kLimbBits - shift) : 0;
+  for (size_t i = an; i-- > 0;) {
+    un[i] = a[i] << shift;
+    if (shift != 0 && i > 0) {
+      un[i] |= a[i - 1] >> (kLimbBits - shift);
+    }
+  }
+  const Uint128 kBase = static_cast<Uint128>(1) << kLimbBits;
+  uint64_t top = vn[bn - 1];
+  uint64_t next = vn[bn - 2];
+  for (size_t j = an - bn + 1; j-- > 0;) {
+    Uint128 num = (static_cast<Uint128>(un[j + bn]) << kLimbBits) |
+                  un[j + bn - 1];
+    Uint128 qhat = num / top;
+    Uint128 rhat = num % top;
+    while (qhat >= kBase ||
+           qhat * next > ((rhat << kLimbBits) | un[j + bn - 2])) {
+      --qhat;
+      rhat += top;
+      if (rhat >= kBase) {
+        break;
+      }
+    }
+    uint64_t borrow =
+        limbs::SubMul1(un + j, vn, bn, static_cast<uint64_t>(qhat));
+    bool negative = un[j + bn] < borrow;
+    un[j + bn] -= borrow;
+    if (negative) {
+      --qhat;
+      un[j + bn] += limbs::AddN(un + j, un + j, vn, bn);
+    }
+    q[j] = static_cast<uint64_t>(qhat);
+  }
+  for (size_t i = 0; i < bn; ++i) {
+    r[i] = un[i] >> shift;
+    if (shift != 0) {
+      r[i] |= un[i + 1] << (kLimbBits - shift);
+    }
+  }
+}
+
+// r[0, 2n) = a^2.
+void SqrAbs(uint64_t* r, const uint64_t* a, size_t n, size_t threads) {
+  if (n < kSqrKaratsubaThreshold) {
+    SqrSchoolbook(r, a, n);
+    return;
+  }
+  if (n < kParallelMulLimbs) {
+    threads = 1;
+  }
+  if (n >= kNttThreshold) {
+    MulNtt(r, a, n, a, n, threads);
+  } else if (n >= kToom3Threshold) {
+    MulToom3(r, a, n, a, n, threads);
+  } else {
+    SqrKaratsuba(r, a, n, threads);
+  }
+}
+
+// r[0, an + bn) = a * b.
+void MulAbs(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+            size_t bn, size_t threads) {
+  if (a == b && an == bn) {
+    SqrAbs(r, a, an, threads);
+    return;
+  }
+  if (an < bn) {
+    std::swap(a, b);
+    std::swap(an, bn);
+  }
+  if (bn < kKaratsubaThreshold) {
+    MulSchoolbook(r, a, an, b, bn);
+    return;
+  }
+  if (bn < kParallelMulLimbs) {
+    threads = 1;
+  }
+  if (bn >= kNttThreshold) {
+    MulNtt(r, a, an, b, bn, threads);
+    return;
+  }
+  if (2 * bn <= an) {
+    std::fill(r, r + an + bn, 0);
+    LimbVector part(2 * bn);
+    for (size_t i = 0; i < an; i += bn) {
+      size_t len = std::min(bn, an - i);
+      MulAbs(part.data(), a + i, len, b, bn, threads);
+      limbs::Add(r + i, r + i, an + bn - i, part.data(), len + bn);
+    }
+    return;
+  }
+  if (bn < kToom3Threshold || bn <= 2 * ((an + 2) / 3)) {
+    MulKaratsuba(r, a, an, b, bn, threads);
+    return;
+  }
+  MulToom3(r, a, an, b, bn, threads);
+}
+
+// Divisor and quotient sizes in limbs from which Newton division beats
+// Algorithm D (measured on 2n / n divisions, crossover near 2000 limbs).
+const size_t kNewtonThreshold = 2000;
+static_assert(kNewtonThreshold >= 6, "Reciprocal needs h < m");
+
+void DivModAbs(const uint64_t* a, size_t an, const uint64_t* b, size_t bn,
+               uint64_t* q, uint64_t* r);
+
+// floor(B^(2m) / b) for an m-limb b, B = 2^64. If residual is null the
+// result may also be up to four below that, which saves the product that
+// pins the last unit; otherwise residual receives B^(2m) - b * result.
+LimbVector Reciprocal(const LimbVector& b, LimbVector* residual = nullptr) {
+  size_t m = b.size();
+  if (m < kNewtonThreshold) {
+    LimbVector power(2 * m + 1, 0);
+    power[2 * m] = 1;
+    LimbVector quot(m + 2);
+    LimbVector rem(m);
+    DivModAbs(power.data(), power.size(), b.data(), m, quot.data(),
+              rem.data());
+    quot.resize(limbs::Normalize(quot.data(), quot.size()));
+    if (residual != nullptr) {
+      rem.resize(limbs::Normalize(rem.data(), rem.size()));
+      *residual = std::move(rem);
+    }
+    return quot;
+  }
+  // The reciprocal of the top h limbs has relative error below B^(1 - h);
+  // one Newton step squares it, which leaves an O(1) absolute error for
+  // h > m / 2 + 1.
+  size_t h = (m + 1) / 2 + 2;
+  LimbVector top(b.end() - h, b.end());
+  // X = X0 * B^(m - h) with X0 = Reciprocal(top) and R0 its residual. For
+  // b = top * B^(m - h) + low the error of X is B^(2m) - b * X =
+  // E * B^(m - h) with E = R0 * B^(m - h) - low * X0, so only the low limbs
+  // of b are multiplied.
+  SignedLimbs x0;
+  SignedLimbs error;
+  x0.abs = Reciprocal(top, &error.abs);
+  if (!error.abs.empty()) {
+    error.abs.insert(error.abs.begin(), m - h, 0);
+  }
+  AddSigned(error, MulSigned(Piece(b.data(), 0, m - h), x0), true);
+  // The Newton step X += X * E * B^(m - h) / B^(2m) is X0 * E / B^(2h).
+  // X0 < B^(h + 1), so the low h - 2 limbs of E move it by less than 1/B
+  // and are dropped.
+  SignedLimbs step = error;
+  step.abs.erase(step.abs.begin(),
+                 step.abs.begin() + std::min(h - 2, step.abs.size()));
+  step = MulSigned(x0, step);
+  step.abs.erase(step.abs.begin(),
+                 step.abs.begin() + std::min(h + 2, step.abs.size()));
+  if (step.abs.empty()) {
+    step.neg = false;
+  }
+  SignedLimbs x;
+  x.abs.assign(m - h, 0);
+  x.abs.insert(x.abs.end(), x0.abs.begin(), x0.abs.end());
+  AddSigned(x, step, false);
+  SignedLimbs one;
+  one.abs.push_back(1);
+  if (residual == nullptr) {
+    // The exact Newton step never passes B^(2m) / b, and truncating a
+    // negative step raises X by less than two. X - 2 is therefore at most
+    // the floor, and the Newton error keeps it within four of it.
+    AddSigned(x, one, true);
+    AddSigned(x, one, true);
+    return x.abs;
+  }
+  // The residual of the new X follows from E: E * B^(m - h) - b * step.
+  SignedLimbs divisor;
+  divisor.abs = b;
+  if (!error.abs.empty()) {
+    error.abs.insert(error.abs.begin(), m - h, 0);
+  }
+  AddSigned(error, MulSigned(divisor, step), true);
+  while (error.neg) {
+    AddSigned(error, divisor, false);
+    AddSigned(x, one, true);
+  }
+  while (CompareAbs(error.abs, b) >= 0) {
+    AddSigned(error, divisor, true);
+    AddSigned(x, one, false);
+  }
+  *residual = std::move(error.abs);
+  return x.abs;
+}
+
+void DivModVec(const LimbVector& a, const LimbVector& b, LimbVector* quot,
+               LimbVector* rem) {
+  if (CompareAbs(a, b) < 0) {
+    quot->clear();
+    *rem = a;
+    return;
+  }
+  quot->assign(a.size() - b.size() + 1, 0);
+  rem->assign(b.size(), 0);
+  DivModAbs(a.data(), a.size(), b.data(), b.size(), quot->data(),
+            rem->data());
+  quot->resize(limbs::Normalize(quot->data(), quot->size()));
+  rem->resize(limbs::Normalize(rem->data(), rem->size()));
+}
+
+// Division of x < b * B^m by an m-limb b given inv = Reciprocal(b). As in
+// Barrett reduction only the top m + 1 limbs of x enter the estimate
+// floor(floor(x / B^(m - 1)) * inv / B^(m + 1)), which undershoots the
+// quotient by at most two, or six when inv is up to four below the floor.
+void DivModByReciprocal(const LimbVector& x, const LimbVector& b,
+                        const LimbVector& inv, LimbVector* quot,
+                        LimbVector* rem) {
+  size_t m = b.size();
+  quot->clear();
+  if (x.size() > m - 1) {
+    LimbVector top(x.begin() + (m - 1), x.end());
+    *quot = MulVec(top, inv);
+    if (quot->size() > m + 1) {
+      quot->erase(quot->begin(), quot->begin() + m + 1);
+    } else {
+      quot->clear();
+    }
+  }
+  *rem = x;
+  SubAbs(*rem, MulVec(*quot, b));
+  while (CompareAbs(*rem, b) >= 0) {
+    SubAbs(*rem, b);
+    MulAddSmall(*quot, 1, 1);
+  }
+}
+
+// Division by multiplication with a Newton reciprocal of b. Same contract
+// as DivModKnuth.
+void DivModNewton(const uint64_t* a, size_t an, const uint64_t* b,
+                  size_t bn, uint64_t* q, uint64_t* r) {
+  size_t qn = an - bn + 1;
+  std::fill(q, q + qn, 0);
+  std::fill(r, r + bn, 0);
+  SignedLimbs divisor = Piece(b, 0, bn);
+  SignedLimbs one;
+  one.abs.push_back(1);
+  if (bn > qn + 1) {
+    // Only the top qn + 1 limbs of b matter for the quotient; the estimate
+    // from them is off by at most two and is fixed up with the remainder.
+    size_t skip = bn - qn - 1;
+    LimbVector quot(qn);
+    LimbVector rem(qn + 1);
+    DivModAbs(a + skip, an - skip, b + skip, bn - skip, quot.data(),
+              rem.data());
+    SignedLimbs quotient = Piece(quot.data(), 0, qn);
+    SignedLimbs remainder = Piece(a, 0, an);
+    AddSigned(remainder, MulSigned(quotient, divisor), true);
+    while (remainder.neg) {
+      AddSigned(remainder, divisor, false);
+      AddSigned(quotient, one, true);
+    }
+    while (CompareAbs(remainder.abs, divisor.abs) >= 0) {
+      AddSigned(remainder, divisor, true);
+      AddSigned(quotient, one, false);
+    }
+    std::copy(quotient.abs.begin(), quotient.abs.end(), q);
+    std::copy(remainder.abs.begin(), remainder.abs.end(), r);
+    return;
+  }
+  // Schoolbook division in base B^bn: each step divides a number below
+  // b * B^bn, so its quotient digit is below B^bn.
+  LimbVector inv = Reciprocal(divisor.abs);
+  LimbVector rem;
+  for (size_t block = (an + bn - 1) / bn; block-- > 0;) {
+    size_t begin = block * bn;
+    LimbVector cur = Piece(a, begin, std::min(an, begin + bn)).abs;
+    if (!rem.empty()) {
+      cur.resize(bn, 0);
+      cur.insert(cur.end(), rem.begin(), rem.end());
+    }
+    LimbVector digit;
+    if (cur.size() <= bn + 1) {
+      // The digit has at most two limbs: Algorithm D is linear here.
+      DivModVec(cur, divisor.abs, &digit, &rem);
+    } else {
+      DivModByReciprocal(cur, divisor.abs, inv, &digit, &rem);
+    }
+    for (size_t i = 0; i < digit.size() && begin + i < qn; ++i) {
+      q[begin + i] = digit[i];
+    }
+  }
+  std::copy(rem.begin(), rem.end(), r);
+}
+
+// Requires an >= bn >= 1 and b[bn - 1] != 0; writes q[0, an - bn + 1) and
+// r[0, bn).
+void DivModAbs(const uint64_t* a, size_t an, const uint64_t* b, size_t bn,
+               uint64_t* q, uint64_t* r) {
+  if (bn == 1) {
+    LimbVector quot(a, a + an);
+    r[0] = DivRemSmall(quot, b[0]);
+    std::fill(q, q + an, 0);
+    std::copy(quot.begin(), quot.end(), q);
+    return;
+  }
+  if (bn >= kNewtonThreshold && an - bn + 1 >= kNewtonThreshold) {
+    DivModNewton(a, an, b, bn, q, r);
+    return;
+  }
+  DivModKnuth(a, an, b, bn, q, r);
+}
+
+std::atomic<size_t> thread_count(1);
+
+// Values up to this many limbs are converted by repeated division by 10^19.
+const size_t kConversionLeafLimbs = 40;
+const size_t kConversionLeafDigits = kConversionLeafLimbs * kDecimalDigits;
+// Halves at least this large may be converted on another thread.
+const size_t kParallelConversionLimbs = 20000;
+
+// Powers of ten from this many limbs are divided by through a cached
+// reciprocal instead of a fresh division.
+const size_t kConversionReciprocalLimbs = 150;
+
+struct PowerOfTenEntry {
+  std::once_flag value_once;
+  LimbVector value;
+  std::once_flag inverse_once;
+  LimbVector inverse;
+};
+
+// 10^(19 * 2^level), shared by all conversions, with its Reciprocal once
+// with_inverse has been requested. Each value is computed once, by the
+// first thread to ask for it, and with no lock held, so the products and
+// divisions may run parallel loops. A deque keeps references stable while
+// other threads extend it.
+const PowerOfTenEntry& PowerOfTen(size_t level, bool with_inverse) {
+  // The cache outlives any arena.
+  ArenaScope heap(nullptr);
+  static std::mutex mutex;
+  static std::deque<PowerOfTenEntry> powers;
+  PowerOfTenEntry* entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (powers.size() <= level) {
+      powers.emplace_back();
+    }
+    entry = &powers[level];
+  }
+  std::call_once(entry->value_once, [&] {
+    if (level == 0) {
+      entry->value.assign(1, kDecimalBase);
+    } else {
+      const LimbVector& half = PowerOfTen(level - 1, false).value;
+      entry->value = MulVec(half, half, thread_count);
+    }
+  });
+  if (with_inverse) {
+    std::call_once(entry->inverse_once,
+                   [&] { entry->inverse = Reciprocal(entry->value); });
+  }
+  return *entry;
+}
 
-BigInt::BigInt(int64_t num) {
-  if (num == 0) {
-    x_.push_back(0);
+size_t DecimalWidth(size_t level) { return kDecimalDigits << level; }
+
+// Writes x < 10^width as exactly width digits, zero padded.
+void WriteDigitsSmall(LimbVector x, char* out, size_t width) {
+  char* pos = out + width;
+  while (!x.empty()) {
+    uint64_t chunk = DivRemSmall(x, kDecimalBase);
+    for (int i = 0; i < kDecimalDigits && pos > out; ++i) {
+      *--pos = static_cast<char>('0' + chunk % 10);
+      chunk /= 10;
+    }
   }
-  if (num < 0) {
-    sign_ = true;
+  std::fill(out, pos, '0');
+}
+
+// Writes x < 10^(2 * DecimalWidth(level)) as exactly that many digits.
+void WriteDigits(const LimbVector& x, size_t level, char* out,
+                 size_t threads) {
+  size_t width = 2 * DecimalWidth(level);
+  if (x.size() <= kConversionLeafLimbs) {
+    WriteDigitsSmall(x, out, width);
+    return;
   }
-  if (sign_) {
-    int res = std::abs(std::abs(num + 1) % kName);
-    ++res;
-    if (res == kName) {
-      res = 0;
+  LimbVector high;
+  LimbVector low;
+  const LimbVector& power = PowerOfTen(level, false).value;
+  if (power.size() >= kConversionReciprocalLimbs) {
+    DivModByReciprocal(x, power, PowerOfTen(level, true).inverse, &high,
+                       &low);
+  } else {
+    DivModVec(x, power, &high, &low);
+  }
+  size_t half = width / 2;
+  if (threads > 1 && x.size() >= 2 * kParallelConversionLimbs) {
+    ParallelFor(2, 2, [&](size_t begin, size_t) {
+      if (begin == 0) {
+        WriteDigits(high, level - 1, out, threads / 2);
+      } else {
+        WriteDigits(low, level - 1, out + half, threads - threads / 2);
+      }
+    });
+    return;
+  }
+  WriteDigits(high, level - 1, out, 1);
+  WriteDigits(low, level - 1, out + half, 1);
+}
+
+// Values that fit in the inline limbs are formatted in a stack buffer of
+// this many characters, sign included (2^128 < 10^39).
+const size_t kStackDecimalChars = 20 * LimbVector::kInlineLimbs + 1;
+
+// The thread-local buffers of the stream operators are kept for reuse only
+// up to this many characters, so that printing or reading one huge value
+// does not pin its memory for the life of the thread. AppendDigits needs
+// fewer than 40 characters per limb.
+const size_t kMaxStreamBufferChars = size_t(4) << 20;
+const size_t kMaxStreamBufferLimbs = (kMaxStreamBufferChars - 1) / 40;
+
+// Writes x, which fits in the inline limbs, as decimal digits ending at end
+// and returns where they begin.
+char* WriteSmallDecimal(const LimbVector& x, char* end) {
+  Uint128 value = 0;
+  for (size_t i = x.size(); i-- > 0;) {
+    value = (value << kLimbBits) | x[i];
+  }
+  for (; value >= kDecimalBase; value /= kDecimalBase) {
+    uint64_t chunk = static_cast<uint64_t>(value % kDecimalBase);
+    for (int i = 0; i < kDecimalDigits; ++i) {
+      *--end = static_cast<char>('0' + chunk % 10);
+      chunk /= 10;
     }
-    x_.push_back(res);
-    num /= kName;
   }
-  num = std::abs(num);
-  while (num != 0) {
-    int res = num % kName;
-    x_.push_back(res);
-    num /= kName;
+  uint64_t chunk = static_cast<uint64_t>(value);
+  do {
+    *--end = static_cast<char>('0' + chunk % 10);
+    chunk /= 10;
+  } while (chunk != 0);
+  return end;
+}
+
+// Writes the decimal digits of x > 0 to (*out)[offset, out->size()) after
+// resizing *out to fit them, and returns the position of the first
+// significant digit. Shrinking a string keeps its capacity, so a buffer
+// that is reused stops allocating.
+size_t AppendDigits(const LimbVector& x, size_t offset, std::string* out) {
+  size_t level = 0;
+  while (CompareAbs(x, PowerOfTen(level + 1, false).value) >= 0) {
+    ++level;
   }
-  reverse(x_.begin(), x_.end());
+  size_t width = 2 * DecimalWidth(level);
+  out->resize(offset + width);
+  WriteDigits(x, level, &(*out)[offset], thread_count);
+  return std::min(out->find_first_not_of('0', offset), out->size() - 1);
 }
 
-BigInt::BigInt(const std::string& str) {
-  for (auto i = static_cast<size_t>(sign_ = str[0] == '-'); i < str.size();
-       ++i) {
-    x_.push_back(str[i] - '0');
+// Value of the decimal digits [digits, digits + len).
+LimbVector ParseDigits(const char* digits, size_t len, size_t threads) {
+  LimbVector res;
+  if (len <= kConversionLeafDigits) {
+    size_t chunk = len % kDecimalDigits;
+    if (chunk == 0) {
+      chunk = kDecimalDigits;
+    }
+    for (size_t i = 0; i < len; i += chunk, chunk = kDecimalDigits) {
+      uint64_t value = 0;
+      uint64_t mul = 1;
+      for (size_t j = i; j < i + chunk; ++j) {
+        value = value * 10 + (digits[j] - '0');
+        mul *= 10;
+      }
+      MulAddSmall(res, mul, value);
+    }
+    return res;
   }
-  if (sign_ && str[1] == '0') {
-    x_.clear();
-    sign_ = false;
+  size_t level = 0;
+  while (2 * DecimalWidth(level) < len) {
+    ++level;
   }
-  if (x_.empty()) {
-    x_.push_back(0), sign_ = false;
+  size_t low_len = DecimalWidth(level);
+  LimbVector high;
+  LimbVector low;
+  if (threads > 1 && low_len >= kParallelConversionLimbs * kDecimalDigits) {
+    ParallelFor(2, 2, [&](size_t begin, size_t) {
+      if (begin == 0) {
+        high = ParseDigits(digits, len - low_len, threads / 2);
+      } else {
+        low = ParseDigits(digits + len - low_len, low_len,
+                          threads - threads / 2);
+      }
+    });
+  } else {
+    high = ParseDigits(digits, len - low_len, 1);
+    low = ParseDigits(digits + len - low_len, low_len, 1);
+  }
+  res = MulVec(high, PowerOfTen(level, false).value, threads);
+  size_t size = std::max(res.size(), low.size()) + 1;
+  res.resize(size, 0);
+  limbs::Add(res.data(), res.data(), size, low.data(), low.size());
+  res.resize(limbs::Normalize(res.data(), size));
+  return res;
+}
+
+// Moduli from this many limbs are reduced with Barrett's method. Below it,
+// one pass of Algorithm D is cheaper than Barrett's two products.
+const size_t kBarrettThreshold = 8;
+
+size_t BitLength(const LimbVector& x) {
+  if (x.empty()) {
+    return 0;
+  }
+  return x.size() * kLimbBits - __builtin_clzll(x.back());
+}
+
+bool TestBit(const LimbVector& x, size_t bit) {
+  return ((x[bit / kLimbBits] >> (bit % kLimbBits)) & 1) != 0;
+}
+
+// Sliding-window width for an exponent of the given bit length: a width w
+// costs 2^(w - 1) precomputed products and about bits / (w + 1) window
+// products, and these are the sizes where w + 1 becomes cheaper.
+size_t WindowBits(size_t bits) {
+  const size_t kWiderFrom[] = {12, 24, 80, 240, 672, 1792};
+  size_t width = 1;
+  while (width <= 6 && bits > kWiderFrom[width - 1]) {
+    ++width;
+  }
+  return width;
+}
+
+// |x| mod |mod| as a nonnegative residue when x is negative.
+LimbVector ReduceResidue(const LimbVector& x, bool negative,
+                         const LimbVector& mod) {
+  LimbVector res = x;
+  if (CompareAbs(res, mod) >= 0) {
+    LimbVector quot;
+    DivModVec(x, mod, &quot, &res);
+  }
+  if (negative && !res.empty()) {
+    LimbVector diff = mod;
+    SubAbs(diff, res);
+    res.swap(diff);
+  }
+  return res;
+}
+
+// Inputs of at least this many limbs reduce their top halves recursively
+// (half-GCD); below it Lehmer's algorithm does all the work. The crossover
+// is flat between 45 and 80 limbs; at 10000 limbs half-GCD is 7x faster.
+const size_t kHalfGcdThreshold = 60;
+
+// Records the reduction of (a, b) to (alpha, beta) as (a, b) = M (alpha,
+// beta). Every step keeps M unimodular with nonnegative entries.
+struct GcdMatrix {
+  LimbVector m[2][2];
+};
+
+GcdMatrix IdentityMatrix() {
+  GcdMatrix res;
+  res.m[0][0].push_back(1);
+  res.m[1][1].push_back(1);
+  return res;
+}
+
+// x * cx + y * cy.
+LimbVector CombineSmall(const LimbVector& x, uint64_t cx, const LimbVector& y,
+                        uint64_t cy) {
+  size_t size = std::max(x.size(), y.size()) + 2;
+  LimbVector res(size, 0);
+  res[x.size()] = limbs::Mul1(res.data(), x.data(), x.size(), cx);
+  uint64_t carry = limbs::AddMul1(res.data(), y.data(), y.size(), cy);
+  limbs::Add1(res.data() + y.size(), res.data() + y.size(), size - y.size(),
+              carry);
+  res.resize(limbs::Normalize(res.data(), size));
+  return res;
+}
+
+// *res = x * cx - y * cy, or false if that is negative.
+bool MulSubSmall(const LimbVector& x, uint64_t cx, const LimbVector& y,
+                 uint64_t cy, LimbVector* res) {
+  size_t size = std::max(x.size(), y.size()) + 1;
+  res->assign(size, 0);
+  (*res)[x.size()] = limbs::Mul1(res->data(), x.data(), x.size(), cx);
+  uint64_t borrow = limbs::SubMul1(res->data(), y.data(), y.size(), cy);
+  if (limbs::Sub1(res->data() + y.size(), res->data() + y.size(),
+                  size - y.size(), borrow) != 0) {
+    return false;
+  }
+  res->resize(limbs::Normalize(res->data(), size));
+  return true;
+}
+
+// x * y + z * w.
+LimbVector MulAddVec(const LimbVector& x, const LimbVector& y,
+                     const LimbVector& z, const LimbVector& w) {
+  LimbVector res = MulVec(x, y);
+  LimbVector other = MulVec(z, w);
+  if (res.size() < other.size()) {
+    res.swap(other);
+  }
+  res.push_back(0);
+  limbs::Add(res.data(), res.data(), res.size(), other.data(), other.size());
+  res.resize(limbs::Normalize(res.data(), res.size()));
+  return res;
+}
+
+// M = M * N for N with single-limb entries.
+void MulMatrixSmall(GcdMatrix* M, const uint64_t n[2][2]) {
+  for (auto& row : M->m) {
+    LimbVector first = CombineSmall(row[0], n[0][0], row[1], n[1][0]);
+    LimbVector second = CombineSmall(row[0], n[0][1], row[1], n[1][1]);
+    row[0].swap(first);
+    row[1].swap(second);
+  }
+}
+
+void MulMatrix(GcdMatrix* M, const GcdMatrix& N) {
+  for (auto& row : M->m) {
+    LimbVector first = MulAddVec(row[0], N.m[0][0], row[1], N.m[1][0]);
+    LimbVector second = MulAddVec(row[0], N.m[0][1], row[1], N.m[1][1]);
+    row[0].swap(first);
+    row[1].swap(second);
+  }
+}
+
+// One exact Euclid step that keeps both values at least B^s: the larger one,
+// x, becomes x - q * y for the largest such q. Returns false when there is
+// none, i.e. when the smaller value or the difference is below B^s. M may be
+// null.
+bool GcdStep(LimbVector* a, LimbVector* b, size_t s, GcdMatrix* M) {
+  bool a_larger = CompareAbs(*a, *b) >= 0;
+  LimbVector& x = a_larger ? *a : *b;
+  const LimbVector& y = a_larger ? *b : *a;
+  if (y.size() <= s) {
+    return false;
+  }
+  LimbVector rest = x;
+  limbs::Sub1(rest.data() + s, rest.data() + s, rest.size() - s, 1);
+  rest.resize(limbs::Normalize(rest.data(), rest.size()));
+  if (CompareAbs(rest, y) < 0) {
+    return false;
+  }
+  LimbVector quot;
+  LimbVector rem;
+  DivModVec(rest, y, &quot, &rem);
+  rem.resize(std::max(rem.size(), s) + 1, 0);
+  limbs::Add1(rem.data() + s, rem.data() + s, rem.size() - s, 1);
+  rem.resize(limbs::Normalize(rem.data(), rem.size()));
+  x.swap(rem);
+  if (M != nullptr) {
+    int to = a_larger ? 1 : 0;
+    for (auto& row : M->m) {
+      LimbVector prod = MulVec(quot, row[1 - to]);
+      if (row[to].size() < prod.size()) {
+        row[to].swap(prod);
+      }
+      row[to].push_back(0);
+      limbs::Add(row[to].data(), row[to].data(), row[to].size(), prod.data(),
+                 prod.size());
+      row[to].resize(limbs::Normalize(row[to].data(), row[to].size()));
+    }
+  }
+  return true;
+}
+
+// Lehmer's step: runs Euclid on the leading 64 bits of a and b in machine
+// words, then applies the accumulated single-limb cofactors to the full
+// values in one pass each. The quotients of the truncated values are only
+// trusted while the remainders stay well above the truncation error, and the
+// result is checked exactly, so a bad guess just returns false.
+bool LehmerStep(LimbVector* a, LimbVector* b, size_t s, GcdMatrix* M) {
+  size_t n = std::max(a->size(), b->size());
+  uint64_t x = 0;
+  uint64_t y = 0;
+  uint64_t limit = 1;
+  if (n == 1) {
+    x = a->empty() ? 0 : (*a)[0];
+    y = b->empty() ? 0 : (*b)[0];
+  } else {
+    int shift = __builtin_clzll((a->size() == n ? *a : *b)[n - 1]);
+    auto top = [&](const LimbVector& v) {
+      uint64_t hi = v.size() >= n ? v[n - 1] : 0;
+      uint64_t lo = v.size() >= n - 1 ? v[n - 2] : 0;
+      return shift == 0 ? hi : (hi << shift) | (lo >> (kLimbBits - shift));
+    };
+    x = top(*a);
+    y = top(*b);
+    // Both values must stay at least B^s, i.e. 2^(64s - dropped) here, with
+    // a bit to spare for the bits that were cut off.
+    int64_t dropped = static_cast<int64_t>(n - 1) * kLimbBits - shift;
+    int64_t bound = static_cast<int64_t>(s) * kLimbBits - dropped + 1;
+    if (bound >= kLimbBits - 1) {
+      return false;
+    }
+    limit = uint64_t{1} << std::max<int64_t>(bound, kLimbBits / 2);
+  }
+  uint64_t cof[2][2] = {{1, 0}, {0, 1}};
+  bool progress = false;
+  while (x != 0 && y != 0) {
+    if (x >= y) {
+      uint64_t q = x / y;
+      if (x - q * y < limit) {
+        break;
+      }
+      x -= q * y;
+      cof[0][1] += q * cof[0][0];
+      cof[1][1] += q * cof[1][0];
+    } else {
+      uint64_t q = y / x;
+      if (y - q * x < limit) {
+        break;
+      }
+      y -= q * x;
+      cof[0][0] += q * cof[0][1];
+      cof[1][0] += q * cof[1][1];
+    }
+    progress = true;
+  }
+  if (!progress) {
+    return false;
+  }
+  LimbVector alpha;
+  LimbVector beta;
+  if (!MulSubSmall(*a, cof[1][1], *b, cof[0][1], &alpha) ||
+      !MulSubSmall(*b, cof[0][0], *a, cof[1][0], &beta) ||
+      alpha.size() <= s || beta.size() <= s) {
+    return false;
+  }
+  a->swap(alpha);
+  b->swap(beta);
+  if (M != nullptr) {
+    MulMatrixSmall(M, cof);
+  }
+  return true;
+}
+
+// Reduces (a, b) while both stay at least B^s.
+void LehmerReduce(LimbVector* a, LimbVector* b, size_t s, GcdMatrix* M) {
+  while (LehmerStep(a, b, s, M) || GcdStep(a, b, s, M)) {
+  }
+}
+
+LimbVector LowLimbs(const LimbVector& x, size_t p) {
+  LimbVector res(x.begin(), x.begin() + std::min(p, x.size()));
+  res.resize(limbs::Normalize(res.data(), res.size()));
+  return res;
+}
+
+// top * B^p + cx * (x mod B^p) - cy * (y mod B^p).
+SignedLimbs Lift(const LimbVector& top, size_t p, const LimbVector& cx,
+                 const LimbVector& x, const LimbVector& cy,
+                 const LimbVector& y) {
+  SignedLimbs res;
+  res.abs = MulVec(cx, LowLimbs(x, p));
+  SignedLimbs sub;
+  sub.abs = MulVec(cy, LowLimbs(y, p));
+  AddSigned(res, sub, true);
+  SignedLimbs high;
+  if (!top.empty()) {
+    high.abs.assign(p, 0);
+    high.abs.insert(high.abs.end(), top.begin(), top.end());
+  }
+  AddSigned(res, high, false);
+  return res;
+}
+
+void HalfGcd(LimbVector* a, LimbVector* b, GcdMatrix* M);
+
+// Reduces a / B^p and b / B^p recursively and applies the resulting matrix
+// to a and b, unless that would take either below B^s.
+void ReduceTop(LimbVector* a, LimbVector* b, size_t p, size_t s,
+               GcdMatrix* M) {
+  if (a->size() <= p || b->size() <= p) {
+    return;
+  }
+  LimbVector a_top(a->begin() + p, a->end());
+  LimbVector b_top(b->begin() + p, b->end());
+  GcdMatrix sub = IdentityMatrix();
+  HalfGcd(&a_top, &b_top, &sub);
+  if (sub.m[0][1].empty() && sub.m[1][0].empty()) {
+    return;
+  }
+  SignedLimbs alpha = Lift(a_top, p, sub.m[1][1], *a, sub.m[0][1], *b);
+  SignedLimbs beta = Lift(b_top, p, sub.m[0][0], *b, sub.m[1][0], *a);
+  if (alpha.neg || beta.neg || alpha.abs.size() <= s ||
+      beta.abs.size() <= s) {
+    return;
+  }
+  a->swap(alpha.abs);
+  b->swap(beta.abs);
+  if (M != nullptr) {
+    MulMatrix(M, sub);
+  }
+}
+
+// Reduces n-limb a and b until one of them is about n / 2 limbs, with the
+// top half reduced by a recursive call on the leading limbs (Schoenhage's
+// half-GCD), then the next quarter the same way.
+void HalfGcd(LimbVector* a, LimbVector* b, GcdMatrix* M) {
+  size_t n = std::max(a->size(), b->size());
+  size_t s = n / 2 + 1;
+  if (std::min(a->size(), b->size()) <= s) {
+    return;
+  }
+  if (n >= kHalfGcdThreshold) {
+    ReduceTop(a, b, s, s, M);
+    GcdStep(a, b, s, M);
+    size_t m = std::max(a->size(), b->size());
+    // The first call normally leaves about 3n / 4 limbs. If it left much
+    // more, the second one would recurse on nearly all of a and b and the
+    // recursion would shrink by only a few limbs per level.
+    if (m > s + 1 && 4 * m <= 7 * s) {
+      ReduceTop(a, b, 2 * s - m, s, M);
+    }
+  }
+  LehmerReduce(a, b, s, M);
+}
+
+// Reduces nonzero a and b to gcd(a, b), recording the steps in M unless it
+// is null.
+LimbVector GcdAbs(LimbVector a, LimbVector b, GcdMatrix* M) {
+  while (std::max(a.size(), b.size()) >= kHalfGcdThreshold) {
+    size_t before = a.size() + b.size();
+    HalfGcd(&a, &b, M);
+    if (a.size() + b.size() == before && !GcdStep(&a, &b, 0, M)) {
+      break;
+    }
+  }
+  LehmerReduce(&a, &b, 0, M);
+  return a;
+}
+
+LimbVector ShiftLeftBits(const LimbVector& x, size_t bits) {
+  LimbVector res;
+  if (x.empty()) {
+    return res;
+  }
+  size_t limb_shift = bits / kLimbBits;
+  int shift = bits % kLimbBits;
+  res.assign(x.size() + limb_shift + 1, 0);
+  for (size_t i = 0; i < x.size(); ++i) {
+    res[i + limb_shift] |= x[i] << shift;
+    if (shift != 0) {
+      res[i + limb_shift + 1] = x[i] >> (kLimbBits - shift);
+    }
+  }
+  res.resize(limbs::Normalize(res.data(), res.size()));
+  return res;
+}
+
+LimbVector ShiftRightBits(const LimbVector& x, size_t bits) {
+  LimbVector res;
+  size_t limb_shift = bits / kLimbBits;
+  int shift = bits % kLimbBits;
+  if (limb_shift >= x.size()) {
+    return res;
+  }
+  res.assign(x.size() - limb_shift, 0);
+  for (size_t i = 0; i < res.size(); ++i) {
+    res[i] = x[i + limb_shift] >> shift;
+    if (shift != 0 && i + limb_shift + 1 < x.size()) {
+      res[i] |= x[i + limb_shift + 1] << (kLimbBits - shift);
+    }
+  }
+  res.resize(limbs::Normalize(res.data(), res.size()));
+  return res;
+}
+
+LimbVector PowVec(const LimbVector& x, uint64_t k) {
+  LimbVector res(1, 1);
+  for (int bit = kLimbBits - 1 - __builtin_clzll(k); bit >= 0; --bit) {
+    res = MulVec(res, res);
+    if (((k >> bit) & 1) != 0) {
+      res = MulVec(res, x);
+    }
+  }
+  return res;
+}
+
+// floor(sqrt(n)) by the precision-doubling Newton iteration: with c =
+// floor((bits(n) - 1) / 2), a approximates the root of n / 4^(c - d) to
+// within one, and each step roughly doubles d at the cost of one division of
+// about d bits by d / 2 bits. The first 26 bits come from the FPU.
+LimbVector SqrtAbs(const LimbVector& n) {
+  if (n.empty()) {
+    return LimbVector();
+  }
+  size_t c = (BitLength(n) - 1) / 2;
+  int steps = 0;
+  while ((c >> steps) > 25) {
+    ++steps;
+  }
+  size_t d = c >> steps;
+  LimbVector top = ShiftRightBits(n, 2 * (c - d));
+  uint64_t m = top[0];
+  uint64_t root = static_cast<uint64_t>(std::sqrt(static_cast<double>(m)));
+  while (root * root > m) {
+    --root;
+  }
+  while ((root + 1) * (root + 1) <= m) {
+    ++root;
+  }
+  LimbVector a(1, root);
+  while (steps-- > 0) {
+    size_t e = d;
+    d = c >> steps;
+    LimbVector quot;
+    LimbVector rem;
+    DivModVec(ShiftRightBits(n, 2 * c - e - d + 1), a, &quot, &rem);
+    a = ShiftLeftBits(a, d - e - 1);
+    a.resize(std::max(a.size(), quot.size()) + 1, 0);
+    limbs::Add(a.data(), a.data(), a.size(), quot.data(), quot.size());
+    a.resize(limbs::Normalize(a.data(), a.size()));
+  }
+  if (CompareAbs(MulVec(a, a), n) > 0) {
+    limbs::Sub1(a.data(), a.data(), a.size(), 1);
+    a.resize(limbs::Normalize(a.data(), a.size()));
+  }
+  return a;
+}
+
+// Roots this short are estimated in floating point and corrected exactly.
+const size_t kDirectRootBits = 40;
+
+// floor(n^(1/k)) for n > 0 and k >= 2. The root of the leading bits, shifted
+// into place and rounded up, bounds the root from above with half of its
+// bits right; Newton's iteration x = ((k - 1) x + n / x^(k - 1)) / k then
+// descends to it in a few steps, so the cost is dominated by the top level.
+LimbVector RootAbs(const LimbVector& n, uint64_t k) {
+  size_t bits = BitLength(n);
+  size_t root_bits = (bits - 1) / k + 1;
+  if (root_bits == 1) {
+    // k >= bits, so 2^k > n.
+    return LimbVector(1, 1);
+  }
+  if (root_bits <= kDirectRootBits) {
+    size_t shift = bits > kLimbBits ? bits - kLimbBits : 0;
+    uint64_t top = ShiftRightBits(n, shift)[0];
+    double estimate = std::exp2(
+        (std::log2(static_cast<double>(top)) + static_cast<double>(shift)) /
+        static_cast<double>(k));
+    // The root has at most root_bits bits. Keeping the candidates below
+    // that bounds every power by 2^(root_bits * k) < 2^(bits + k), and
+    // root_bits >= 2 means k < bits.
+    uint64_t limit = (uint64_t{1} << root_bits) - 1;
+    uint64_t root = std::min(
+        std::max<uint64_t>(static_cast<uint64_t>(estimate), 1), limit);
+    while (CompareAbs(PowVec(LimbVector(1, root), k), n) > 0) {
+      --root;
+    }
+    while (root < limit &&
+           CompareAbs(PowVec(LimbVector(1, root + 1), k), n) <= 0) {
+      ++root;
+    }
+    return LimbVector(1, root);
+  }
+  size_t half = root_bits / 2;
+  LimbVector x = RootAbs(ShiftRightBits(n, k * half), k);
+  x.push_back(0);
+  limbs::Add1(x.data(), x.data(), x.size(), 1);
+  x.resize(limbs::Normalize(x.data(), x.size()));
+  x = ShiftLeftBits(x, half);
+  while (true) {
+    LimbVector quot;
+    LimbVector rem;
+    DivModVec(n, PowVec(x, k - 1), &quot, &rem);
+    LimbVector next = x;
+    MulAddSmall(next, k - 1, 0);
+    next.resize(std::max(next.size(), quot.size()) + 1, 0);
+    limbs::Add(next.data(), next.data(), next.size(), quot.data(),
+               quot.size());
+    next.resize(limbs::Normalize(next.data(), next.size()));
+    DivRemSmall(next, k);
+    if (CompareAbs(next, x) >= 0) {
+      return x;
+    }
+    x.swap(next);
+  }
+}
+
+// Multiplies neighbouring values while the product fits in a limb, giving
+// the leaves of a product tree.
+std::vector<LimbVector> PackWords(const std::vector<uint64_t>& values) {
+  std::vector<LimbVector> leaves;
+  uint64_t acc = 1;
+  for (uint64_t value : values) {
+    if ((static_cast<Uint128>(acc) * value) >> kLimbBits != 0) {
+      leaves.emplace_back(1, acc);
+      acc = 1;
+    }
+    acc *= value;
+  }
+  if (acc != 1 || leaves.empty()) {
+    leaves.emplace_back(1, acc);
+  }
+  return leaves;
+}
+
+// Product of leaves[begin, end) by binary splitting. The range is split at
+// half its total size rather than half its count, so the two operands of
+// every product are about the same size even for uneven leaves. offsets[i]
+// is the total size of leaves[0, i).
+LimbVector ProductTree(const std::vector<LimbVector>& leaves,
+                       const std::vector<size_t>& offsets, size_t begin,
+                       size_t end, size_t threads) {
+  if (end - begin == 1) {
+    return leaves[begin];
+  }
+  size_t target = (offsets[begin] + offsets[end]) / 2;
+  size_t mid = std::upper_bound(offsets.begin() + begin + 1,
+                                offsets.begin() + end, target) -
+               offsets.begin();
+  mid = std::min(std::max(mid - 1, begin + 1), end - 1);
+  LimbVector low;
+  LimbVector high;
+  if (threads > 1 && offsets[end] - offsets[begin] >= 2 * kParallelMulLimbs) {
+    ParallelFor(2, 2, [&](size_t part, size_t) {
+      if (part == 0) {
+        high = ProductTree(leaves, offsets, mid, end, threads / 2);
+      } else {
+        low = ProductTree(leaves, offsets, begin, mid, threads - threads / 2);
+      }
+    });
+  } else {
+    low = ProductTree(leaves, offsets, begin, mid, 1);
+    high = ProductTree(leaves, offsets, mid, end, 1);
+  }
+  return MulVec(low, high, threads);
+}
+
+LimbVector ProductOf(const std::vector<LimbVector>& leaves, size_t threads) {
+  if (leaves.empty()) {
+    return LimbVector(1, 1);
+  }
+  std::vector<size_t> offsets(1, 0);
+  for (const auto& leaf : leaves) {
+    offsets.push_back(offsets.back() + leaf.size());
+  }
+  return ProductTree(leaves, offsets, 0, leaves.size(), threads);
+}
+
+// Primes up to n, by a sieve over the odd numbers.
+std::vector<uint64_t> PrimesUpTo(uint64_t n) {
+  std::vector<uint64_t> primes;
+  if (n < 2) {
+    return primes;
+  }
+  primes.push_back(2);
+  std::vector<bool> composite((n + 1) / 2);
+  for (uint64_t i = 1; 2 * i + 1 <= n; ++i) {
+    if (composite[i]) {
+      continue;
+    }
+    uint64_t p = 2 * i + 1;
+    primes.push_back(p);
+    for (uint64_t j = p * p / 2; p <= n / p && 2 * j + 1 <= n; j += p) {
+      composite[j] = true;
+    }
+  }
+  return primes;
+}
+
+// Product of primes[i]^exps[i]. The primes whose exponent has bit b set are
+// multiplied by a product tree, and these groups are combined by squaring
+// from the top bit down, so nearly all the work is in balanced products and
+// squares.
+LimbVector PrimePowerProduct(const std::vector<uint64_t>& primes,
+                             const std::vector<uint64_t>& exps,
+                             size_t threads) {
+  uint64_t all_bits = 0;
+  for (uint64_t e : exps) {
+    all_bits |= e;
+  }
+  LimbVector res(1, 1);
+  for (int bit = kLimbBits - 1; bit >= 0; --bit) {
+    if (!(res.size() == 1 && res[0] == 1)) {
+      res = MulVec(res, res, threads);
+    }
+    if (((all_bits >> bit) & 1) == 0) {
+      continue;
+    }
+    std::vector<uint64_t> group;
+    for (size_t i = 0; i < primes.size(); ++i) {
+      if (((exps[i] >> bit) & 1) != 0) {
+        group.push_back(primes[i]);
+      }
+    }
+    res = MulVec(res, ProductOf(PackWords(group), threads), threads);
+  }
+  return res;
+}
+
+LimbVector FactorialAbs(uint64_t n, size_t threads) {
+  std::vector<uint64_t> primes = PrimesUpTo(n);
+  std::vector<uint64_t> exps;
+  for (uint64_t p : primes) {
+    uint64_t e = 0;
+    for (uint64_t m = n / p; m > 0; m /= p) {
+      e += m;
+    }
+    exps.push_back(e);
+  }
+  return PrimePowerProduct(primes, exps, threads);
+}
+
+// Binomials with n above this multiple of k are computed as the falling
+// product n (n - 1) ... (n - k + 1) / k!, which is then barely longer than
+// the result, instead of sieving all primes up to n.
+const uint64_t kFallingBinomialRatio = 16;
+
+}  // namespace
+
+thread_local LimbArena* LimbVector::current_arena_ = nullptr;
+
+LimbVector::LimbVector(size_t size, uint64_t value) : arena_(current_arena_) {
+  assign(size, value);
+}
+
+LimbVector::LimbVector(const LimbVector& other) : arena_(current_arena_) {
+  assign(other.begin(), other.end());
+}
+
+LimbVector::LimbVector(const LimbVector& other, LimbArena* arena)
+    : arena_(arena) {
+  ArenaScope scope(arena);
+  assign(other.begin(), other.end());
+}
+
+LimbVector::LimbVector(LimbVector&& other) noexcept : arena_(other.arena_) {
+  if (other.IsInline()) {
+    size_ = std::copy(other.begin(), other.end(), data_) - data_;
+  } else {
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.data_ = other.inline_;
+    other.capacity_ = kInlineLimbs;
+  }
+  other.size_ = 0;
+}
+
+LimbVector& LimbVector::operator=(const LimbVector& other) {
+  if (this != &other) {
+    assign(other.begin(), other.end());
+  }
+  return *this;
+}
+
+LimbVector& LimbVector::operator=(LimbVector&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (other.IsInline()) {
+    // Keep our buffer, if any: the limbs fit either way.
+    size_ = std::copy(other.begin(), other.end(), data_) - data_;
+  } else if (other.arena_ != nullptr && other.arena_ != arena_) {
+    // Stealing would move this vector into an arena it was not created in.
+    assign(other.begin(), other.end());
+    return *this;
+  } else {
+    Release();
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    arena_ = other.arena_;
+    other.data_ = other.inline_;
+    other.capacity_ = kInlineLimbs;
+  }
+  other.size_ = 0;
+  return *this;
+}
+
+LimbVector::~LimbVector() { Release(); }
+
+void LimbVector::resize(size_t size, uint64_t value) {
+  if (size > capacity_) {
+    Grow(size);
+  }
+  if (size > size_) {
+    std::fill(data_ + size_, data_ + size, value);
+  }
+  size_ = size;
+}
+
+void LimbVector::reserve(size_t capacity) {
+  if (capacity > capacity_) {
+    Reallocate(capacity);
+  }
+}
+
+void LimbVector::assign(size_t size, uint64_t value) {
+  size_ = 0;
+  resize(size, value);
+}
+
+LimbVector::iterator LimbVector::insert(const_iterator pos, size_t count,
+                                        uint64_t value) {
+  size_t offset = pos - data_;
+  if (size_ + count > capacity_) {
+    Grow(size_ + count);
+  }
+  std::copy_backward(data_ + offset, data_ + size_, data_ + size_ + count);
+  std::fill(data_ + offset, data_ + offset + count, value);
+  size_ += count;
+  return data_ + offset;
+}
+
+LimbVector::iterator LimbVector::erase(const_iterator first,
+                                       const_iterator last) {
+  iterator dest = data_ + (first - data_);
+  size_ = std::copy(last, const_iterator(end()), dest) - data_;
+  return dest;
+}
+
+void LimbVector::swap(LimbVector& other) {
+  LimbVector tmp = std::move(other);
+  other = std::move(*this);
+  *this = std::move(tmp);
+}
+
+size_t LimbVector::AllocationCount() { return limb_allocations; }
+
+void LimbVector::Reallocate(size_t capacity) {
+  LimbArena* arena =
+      arena_ != nullptr && arena_ == current_arena_ ? arena_ : nullptr;
+  uint64_t* data;
+  if (arena != nullptr) {
+    data = arena->Allocate(capacity);
+  } else {
+    data = new uint64_t[capacity];
+    limb_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  std::copy(begin(), end(), data);
+  Release();
+  data_ = data;
+  capacity_ = capacity;
+  arena_ = arena;
+}
+
+void LimbVector::Grow(size_t size) {
+  Reallocate(std::max(size, 2 * capacity_));
+}
+
+void LimbVector::Release() {
+  if (!IsInline() && arena_ == nullptr) {
+    delete[] data_;
+  }
+}
+
+uint64_t* LimbArena::Allocate(size_t limbs) {
+  if (static_cast<size_t>(end_ - pos_) < limbs) {
+    size_t size = std::max(limbs, block_limbs_);
+    blocks_.push_back({std::unique_ptr<uint64_t[]>(new uint64_t[size]), size});
+    pos_ = blocks_.back().data.get();
+    end_ = pos_ + size;
+  }
+  uint64_t* data = pos_;
+  pos_ += limbs;
+  return data;
+}
+
+void LimbArena::Reset() {
+  if (blocks_.size() > 1) {
+    size_t size = 0;
+    for (const Block& block : blocks_) {
+      size += block.size;
+    }
+    blocks_.clear();
+    blocks_.push_back({std::unique_ptr<uint64_t[]>(new uint64_t[size]), size});
+  }
+  if (!blocks_.empty()) {
+    pos_ = blocks_[0].data.get();
+    end_ = pos_ + blocks_[0].size;
+  }
+}
+
+bool operator==(const LimbVector& lhs, const LimbVector& rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+BigInt::BigInt() {}
+
+BigInt::BigInt(int64_t num) {
+  sign_ = num < 0;
+  uint64_t abs = sign_ ? 0 - static_cast<uint64_t>(num) : num;
+  if (abs != 0) {
+    x_.push_back(abs);
   }
 }
 
+BigInt::BigInt(const std::string& str) {
+  size_t begin = static_cast<size_t>(sign_ = !str.empty() && str[0] == '-');
+  x_ = ParseDigits(str.data() + begin, str.size() - begin, thread_count);
+  DeleteZeros();
+}
+
+BigInt::BigInt(const BigInt& value, LimbArena* arena)
+    : sign_(value.sign_), x_(value.x_, arena) {}
+
+BigInt::BigInt(const BigIntView& view) {
+  x_.assign(view.limbs, view.limbs + limbs::Normalize(view.limbs, view.size));
+  sign_ = view.negative && !x_.empty();
+}
+
 BigInt BigInt::operator+() const {
+  ArenaScope scope(x_);
   BigInt rhs = *this;
   return rhs;
 }
 
-BigInt BigInt::operator-() const {
+BigInt BigInt::operator-() const& {
+  ArenaScope scope(x_);
   BigInt rhs = *this;
-  rhs.sign_ ^= 1;
-  if (rhs.x_[0] == 0) {
-    rhs.sign_ = false;
-  }
-  return rhs;
+  return -std::move(rhs);
+}
+
+BigInt BigInt::operator-() && {
+  sign_ = !sign_ && !x_.empty();
+  return std::move(*this);
 }
 
 std::string BigInt::ToString() const {
-  std::string str;
-  if (sign_ && (x_.size() > 1 || (x_[0] != 0))) {
-    str = "-";
+  if (x_.size() <= LimbVector::kInlineLimbs) {
+    char text[kStackDecimalChars];
+    char* begin = WriteSmallDecimal(x_, text + kStackDecimalChars);
+    if (sign_) {
+      *--begin = '-';
+    }
+    return std::string(begin, text + kStackDecimalChars);
   }
-  for (ssize_t i = x_.size() - 1; i >= 0; --i) {
-    str += (char)(x_[i] + '0');
+  ArenaScope scope(x_);
+  std::string str;
+  size_t first = AppendDigits(x_, 1, &str);
+  if (sign_) {
+    str[--first] = '-';
   }
+  str.erase(0, first);
   return str;
 }
 
+size_t BigInt::BinaryWords() const { return 1 + x_.size(); }
+
+uint64_t* BigInt::WriteBinary(uint64_t* out) const {
+  *out++ = (static_cast<uint64_t>(x_.size()) << 1) | (sign_ ? 1 : 0);
+  return std::copy(x_.begin(), x_.end(), out);
+}
+
+void BigInt::WriteBinary(std::ostream& out) const {
+  uint64_t header = (static_cast<uint64_t>(x_.size()) << 1) | (sign_ ? 1 : 0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(x_.data()),
+            x_.size() * sizeof(uint64_t));
+}
+
+void BigInt::SetThreadCount(size_t count) {
+  thread_count = std::max<size_t>(count, 1);
+  // The calling thread is the last of the count threads.
+  WorkerPool::Instance().Resize(thread_count - 1);
+}
+
 bool BigInt::operator<(const BigInt& rhs) const {
   if (sign_ != rhs.sign_) {
     return !(static_cast<int>(sign_) < static_cast<int>(rhs.sign_));
   }
-  if (x_.size() != rhs.x_.size()) {
-    if (sign_) {
-      return x_.size() > rhs.x_.size();
-    }
-    return x_.size() < rhs.x_.size();
-  }
-  for (size_t i = 0; i < x_.size(); ++i) {
-    if (x_[i] != rhs.x_[i]) {
-      if (sign_) {
-        return x_[i] > rhs.x_[i];
-      }
-      return x_[i] < rhs.x_[i];
-    }
-  }
-  return false;
+  int cmp = CompareAbs(x_, rhs.x_);
+  return sign_ ? cmp > 0 : cmp < 0;
 }
 
 bool BigInt::operator>(const BigInt& rhs) const { return rhs < *this; }
@@ -97,243 +2489,837 @@ bool BigInt::operator==(const BigInt& rhs) const {
 }
 bool BigInt::operator!=(const BigInt& rhs) const { return !(*this == rhs); }
 
-BigInt::operator bool() const { return *this != 0; }
+BigInt::operator bool() const { return !x_.empty(); }
 
 BigInt Sum(const BigInt& lhs, const BigInt& rhs) {
-  BigInt right = lhs;
-  BigInt rhs1 = rhs;
-  reverse(right.x_.begin(), right.x_.end());
-  reverse(rhs1.x_.begin(), rhs1.x_.end());
-  right.x_.resize(std::max(lhs.x_.size(), rhs.x_.size()) + 1);
-  for (size_t i = 0; i < rhs1.x_.size(); i++) {
-    right.x_[i] += rhs1.x_[i];
-    if (right.x_[i] >= kName) {
-      right.x_[i] -= kName;
-      ++right.x_[i + 1];
-    }
-  }
-  for (size_t i = rhs1.x_.size(); i < right.x_.size(); ++i) {
-    if (right.x_[i] >= kName) {
-      right.x_[i] -= kName;
-      ++right.x_[i + 1];
+  bool lhs_longer = lhs.x_.size() >= rhs.x_.size();
+  const LimbVector& big = lhs_longer ? lhs.x_ : rhs.x_;
+  const LimbVector& small = lhs_longer ? rhs.x_ : lhs.x_;
+  BigInt right;
+  right.x_.resize(big.size());
+  uint64_t carry = limbs::Add(right.x_.data(), big.data(), big.size(),
+                              small.data(), small.size());
+  if (carry != 0) {
+    right.x_.push_back(carry);
+  }
+  return right;
+}
+
+BigInt Sub(const BigInt& lhs, const BigInt& rhs) {
+  BigInt right;
+  right.x_.resize(lhs.x_.size());
+  limbs::Sub(right.x_.data(), lhs.x_.data(), lhs.x_.size(), rhs.x_.data(),
+             rhs.x_.size());
+  right.DeleteZeros();
+  return right;
+}
+
+BigInt SignedSum(const BigInt& lhs, const BigInt& rhs, bool rhs_sign) {
+  ArenaScope scope(lhs.x_, rhs.x_);
+  if (lhs.sign_ == rhs_sign) {
+    BigInt res = Sum(lhs, rhs);
+    res.sign_ = lhs.sign_;
+    res.DeleteZeros();
+    return res;
+  }
+  if (CompareAbs(lhs.x_, rhs.x_) >= 0) {
+    BigInt res = Sub(lhs, rhs);
+    res.sign_ = lhs.sign_;
+    res.DeleteZeros();
+    return res;
+  }
+  BigInt res = Sub(rhs, lhs);
+  res.sign_ = rhs_sign;
+  res.DeleteZeros();
+  return res;
+}
+
+BigInt operator+(const BigInt& lhs, const BigInt& rhs) {
+  return SignedSum(lhs, rhs, rhs.sign_);
+}
+
+BigInt operator-(const BigInt& lhs, const BigInt& rhs) {
+  return SignedSum(lhs, rhs, !rhs.sign_);
+}
+
+BigInt operator+(BigInt&& lhs, const BigInt& rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+BigInt operator+(const BigInt& lhs, BigInt&& rhs) {
+  rhs += lhs;
+  return std::move(rhs);
+}
+
+BigInt operator+(BigInt&& lhs, BigInt&& rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+BigInt operator-(BigInt&& lhs, const BigInt& rhs) {
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+BigInt operator-(const BigInt& lhs, BigInt&& rhs) {
+  if (&lhs == &rhs) {
+    return BigInt();
+  }
+  BigInt res = -std::move(rhs);
+  res += lhs;
+  return res;
+}
+
+BigInt operator-(BigInt&& lhs, BigInt&& rhs) {
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+void BigInt::Accumulate(const BigInt& rhs, bool rhs_sign) {
+  ArenaScope scope(x_);
+  if (rhs.x_.empty()) {
+    return;
+  }
+  if (this == &rhs) {
+    if (sign_ == rhs_sign) {
+      MulAddSmall(x_, 2, 0);
     } else {
-      break;
+      Clear();
     }
+    return;
   }
-  while (right.x_.size() > 1 && (right.x_.back() == 0)) {
-    right.x_.pop_back();
+  size_t size = rhs.x_.size();
+  if (sign_ == rhs_sign || x_.empty()) {
+    sign_ = rhs_sign;
+    if (x_.size() < size) {
+      x_.resize(size, 0);
+    }
+    if (limbs::Add(x_.data(), x_.data(), x_.size(), rhs.x_.data(), size) != 0) {
+      x_.push_back(1);
+    }
+    return;
   }
-  reverse(right.x_.begin(), right.x_.end());
-  return right;
+  if (CompareAbs(x_, rhs.x_) >= 0) {
+    limbs::Sub(x_.data(), x_.data(), x_.size(), rhs.x_.data(), size);
+  } else {
+    x_.resize(size, 0);
+    limbs::SubN(x_.data(), rhs.x_.data(), x_.data(), size);
+    sign_ = rhs_sign;
+  }
+  DeleteZeros();
 }
 
-BigInt operator+(const BigInt& lhs, const BigInt& rhs) {
-  if (lhs.sign_ && !rhs.sign_) {
-    return rhs - -lhs;
+BigInt& BigInt::operator+=(const BigInt& rhs) {
+  Accumulate(rhs, rhs.sign_);
+  return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& rhs) {
+  Accumulate(rhs, !rhs.sign_);
+  return *this;
+}
+
+BigInt& BigInt::operator*=(const BigInt& rhs) {
+  ArenaScope scope(x_);
+  if (x_.empty() || rhs.x_.empty()) {
+    Clear();
+    return *this;
   }
-  if (!lhs.sign_ && rhs.sign_) {
-    return lhs - -rhs;
+  size_t an = x_.size();
+  size_t bn = rhs.x_.size();
+  if (an + bn <= kSmallProductLimbs) {
+    uint64_t product[kSmallProductLimbs];
+    MulSchoolbook(product, x_.data(), an, rhs.x_.data(), bn);
+    x_.assign(product, product + limbs::Normalize(product, an + bn));
+  } else if (this == &rhs || bn >= kKaratsubaThreshold) {
+    LimbVector product(an + bn);
+    MulAbs(product.data(), x_.data(), an, rhs.x_.data(), bn, thread_count);
+    x_.swap(product);
+  } else {
+    // Schoolbook from the top limb down: row i only overwrites limbs that
+    // hold finished rows or limb i itself.
+    x_.resize(an + bn, 0);
+    for (size_t i = an; i-- > 0;) {
+      uint64_t limb = x_[i];
+      x_[i] = 0;
+      uint64_t carry = limbs::AddMul1(&x_[i], rhs.x_.data(), bn, limb);
+      limbs::Add1(&x_[i + bn], &x_[i + bn], an - i, carry);
+    }
+  }
+  sign_ ^= rhs.sign_;
+  DeleteZeros();
+  return *this;
+}
+
+void BigInt::MulAccumulate(const BigInt& lhs, const BigInt& rhs,
+                           bool negate) {
+  ArenaScope scope(x_);
+  if (lhs.x_.empty() || rhs.x_.empty()) {
+    return;
   }
-  if (lhs.sign_ && rhs.sign_) {
-    return -(-rhs + -lhs);
+  bool product_sign = (lhs.sign_ != rhs.sign_) != negate;
+  const LimbVector* a = &lhs.x_;
+  const LimbVector* b = &rhs.x_;
+  if (a->size() < b->size()) {
+    std::swap(a, b);
   }
-  BigInt res = Sum(lhs, rhs);
-  return res;
+  size_t an = a->size();
+  size_t bn = b->size();
+  if ((sign_ != product_sign && !x_.empty()) || bn >= kKaratsubaThreshold ||
+      this == &lhs || this == &rhs) {
+    BigInt product = lhs * rhs;
+    Accumulate(product, product_sign);
+    return;
+  }
+  sign_ = product_sign;
+  size_t size = std::max(x_.size(), an + bn) + 1;
+  x_.resize(size, 0);
+  for (size_t i = 0; i < bn; ++i) {
+    uint64_t carry = limbs::AddMul1(&x_[i], a->data(), an, (*b)[i]);
+    limbs::Add1(&x_[i + an], &x_[i + an], size - i - an, carry);
+  }
+  DeleteZeros();
 }
 
-BigInt Sub(const BigInt& lhs, const BigInt& rhs) {
-  BigInt right = lhs;
-  BigInt rhs1 = rhs;
-  reverse(right.x_.begin(), right.x_.end());
-  reverse(rhs1.x_.begin(), rhs1.x_.end());
-  for (size_t i = 0; i < rhs1.x_.size(); ++i) {
-    if (right.x_[i] < rhs1.x_[i]) {
-      right.x_[i] += kName;
-      size_t ind = i + 1;
-      while (right.x_[ind] == 0) {
-        right.x_[ind] = kName - 1;
-        ++ind;
-      }
-      --right.x_[ind];
+BigInt& BigInt::AddMul(const BigInt& lhs, const BigInt& rhs) {
+  MulAccumulate(lhs, rhs, false);
+  return *this;
+}
+
+BigInt& BigInt::SubMul(const BigInt& lhs, const BigInt& rhs) {
+  MulAccumulate(lhs, rhs, true);
+  return *this;
+}
+
+void BigInt::AccumulateLimb(uint64_t abs, bool negative) {
+  ArenaScope scope(x_);
+  if (abs == 0) {
+    return;
+  }
+  if (x_.empty() || sign_ == negative) {
+    sign_ = negative;
+    uint64_t carry = limbs::Add1(x_.data(), x_.data(), x_.size(), abs);
+    if (carry != 0) {
+      x_.push_back(carry);
     }
-    right.x_[i] -= rhs1.x_[i];
+    return;
   }
-  while (right.x_.size() > 1 && right.x_.back() == 0) {
-    right.x_.pop_back();
+  if (x_.size() == 1 && x_[0] < abs) {
+    x_[0] = abs - x_[0];
+    sign_ = negative;
+    return;
   }
-  reverse(right.x_.begin(), right.x_.end());
-  return right;
+  limbs::Sub1(x_.data(), x_.data(), x_.size(), abs);
+  DeleteZeros();
 }
 
-BigInt operator-(const BigInt& lhs, const BigInt& rhs) {
-  if (lhs.sign_ && !rhs.sign_) {
-    return -(-lhs + rhs);
+void BigInt::MulLimb(uint64_t abs, bool negative) {
+  ArenaScope scope(x_);
+  if (abs == 0 || x_.empty()) {
+    Clear();
+    return;
+  }
+  uint64_t high = limbs::Mul1(x_.data(), x_.data(), x_.size(), abs);
+  if (high != 0) {
+    x_.push_back(high);
   }
-  if (!lhs.sign_ && rhs.sign_) {
-    return lhs + -rhs;
+  sign_ = sign_ != negative;
+}
+
+void BigInt::DivLimb(uint64_t abs, bool negative) {
+  if (abs == 0) {
+    std::cout << "-1!\n";
+    Clear();
+    return;
   }
-  if (lhs.sign_ && rhs.sign_) {
-    return -rhs - -lhs;
+  limbs::DivRem1(x_.data(), x_.data(), x_.size(), abs);
+  sign_ = sign_ != negative;
+  DeleteZeros();
+}
+
+BigInt BigInt::RemLimb(uint64_t abs) const {
+  ArenaScope scope(x_);
+  if (abs == 0) {
+    std::cout << "-1!\n";
+    return *this;
   }
-  if (lhs < rhs) {
-    return -(rhs - lhs);
+  BigInt res;
+  uint64_t rem = limbs::Mod1(x_.data(), x_.size(), abs);
+  if (rem != 0) {
+    res.x_.push_back(rem);
+    res.sign_ = sign_;
   }
-  BigInt res = Sub(lhs, rhs);
   return res;
 }
 
-BigInt& BigInt::operator+=(const BigInt& rhs) { return *this = *this + rhs; }
-BigInt& BigInt::operator-=(const BigInt& rhs) { return *this = *this - rhs; }
-BigInt& BigInt::operator*=(const BigInt& rhs) { return *this = *this * rhs; }
 BigInt BigInt::operator++(int other) {
+  ArenaScope scope(x_);
   BigInt res = *this;
   ++other;
-  *this = *this + 1;
+  ++*this;
   return res;
 }
 BigInt BigInt::operator--(int other) {
+  ArenaScope scope(x_);
   BigInt res = *this;
   --other;
-  *this = *this - 1;
+  --*this;
   return res;
 }
-BigInt BigInt::operator++() { return *this += 1; }
-BigInt BigInt::operator--() { return *this -= 1; }
+BigInt& BigInt::operator++() {
+  ArenaScope scope(x_);
+  if (sign_) {
+    DecrementAbs(x_);
+    DeleteZeros();
+  } else {
+    IncrementAbs(x_);
+  }
+  return *this;
+}
+BigInt& BigInt::operator--() {
+  ArenaScope scope(x_);
+  if (x_.empty()) {
+    x_.push_back(1);
+    sign_ = true;
+  } else if (sign_) {
+    IncrementAbs(x_);
+  } else {
+    DecrementAbs(x_);
+  }
+  return *this;
+}
 
 void BigInt::DeleteZeros() {
-  while (this->x_.size() > 1 && this->x_.back() == 0) {
+  while (!this->x_.empty() && this->x_.back() == 0) {
     this->x_.pop_back();
   }
-  if (this->x_.size() == 1 && this->x_[0] == 0) {
+  if (this->x_.empty()) {
     this->sign_ = false;
   }
 }
 
 void BigInt::Clear() {
-  std::vector<uint64_t> copy;
-  copy.push_back(0);
-  x_ = copy;
+  x_.clear();
   sign_ = false;
 }
 
-void BigInt::ShiftRight() {
-  if (this->x_.empty()) {
-    this->x_.push_back(0);
+void BigInt::ShiftRight() {}
+
+void DivMod(const BigInt& left, const BigInt& right, BigInt* quotient,
+            BigInt* remainder) {
+  ArenaScope scope(left.x_, right.x_);
+  if (right.x_.empty()) {
+    std::cout << "-1!\n";
+    *remainder = left;
+    quotient->Clear();
     return;
   }
-  this->x_.push_back(this->x_[this->x_.size() - 1]);
-  for (size_t i = this->x_.size() - 2; i > 0; --i) {
-    this->x_[i] = this->x_[i - 1];
+  BigInt quot;
+  BigInt rem;
+  if (CompareAbs(left.x_, right.x_) < 0) {
+    rem.x_ = left.x_;
+  } else if (right.x_.size() == 1) {
+    quot.x_ = left.x_;
+    rem.x_.push_back(DivRemSmall(quot.x_, right.x_[0]));
+  } else {
+    quot.x_.resize(left.x_.size() - right.x_.size() + 1);
+    rem.x_.resize(right.x_.size());
+    DivModAbs(left.x_.data(), left.x_.size(), right.x_.data(),
+              right.x_.size(), quot.x_.data(), rem.x_.data());
   }
-  this->x_[0] = 0;
+  quot.sign_ = left.sign_ != right.sign_;
+  quot.DeleteZeros();
+  rem.sign_ = left.sign_;
+  rem.DeleteZeros();
+  *quotient = std::move(quot);
+  *remainder = std::move(rem);
 }
 
-BigInt Div(const BigInt& left, const BigInt& right, const BigInt& b_right) {
-  BigInt res = b_right;
-  res.sign_ = left.sign_ != right.sign_;
-  while (res.x_.size() > 1) {
-    if (res.x_[0] == 0) {
-      res.x_.erase(res.x_.begin());
-    } else {
-      break;
+BigInt operator/(const BigInt& left, const BigInt& right) {
+  ArenaScope scope(left.x_, right.x_);
+  BigInt quotient;
+  BigInt remainder;
+  DivMod(left, right, &quotient, &remainder);
+  return quotient;
+}
+
+BigInt& BigInt::operator/=(const BigInt& other) {
+  ArenaScope scope(x_, other.x_);
+  BigInt remainder;
+  DivMod(*this, other, this, &remainder);
+  return *this;
+}
+
+BigInt& BigInt::operator%=(const BigInt& other) {
+  ArenaScope scope(x_, other.x_);
+  BigInt quotient;
+  DivMod(*this, other, &quotient, this);
+  return *this;
+}
+
+BigInt& BigInt::operator%=(const Reducer& reducer) {
+  ArenaScope scope(x_);
+  const LimbVector& mod = reducer.mod_.x_;
+  if (reducer.inv_.empty()) {
+    return *this %= reducer.mod_;
+  }
+  if (CompareAbs(x_, mod) < 0) {
+    return *this;
+  }
+  size_t k = mod.size();
+  LimbVector quot;
+  LimbVector rem;
+  if (x_.size() <= 2 * k) {
+    DivModByReciprocal(x_, mod, reducer.inv_, &quot, &rem);
+  } else {
+    // Horner over k-limb blocks keeps every step below m * B^k.
+    LimbVector cur;
+    for (size_t block = (x_.size() + k - 1) / k; block-- > 0;) {
+      size_t begin = block * k;
+      cur.assign(x_.begin() + begin,
+                 x_.begin() + std::min(x_.size(), begin + k));
+      if (!rem.empty()) {
+        cur.resize(k, 0);
+        cur.insert(cur.end(), rem.begin(), rem.end());
+      }
+      cur.resize(limbs::Normalize(cur.data(), cur.size()));
+      DivModByReciprocal(cur, mod, reducer.inv_, &quot, &rem);
     }
   }
-  if (res.x_[0] == 0) {
-    res.sign_ = false;
+  x_.swap(rem);
+  DeleteZeros();
+  return *this;
+}
+
+BigInt BigInt::operator%(const BigInt& other) const {
+  ArenaScope scope(x_, other.x_);
+  BigInt quotient;
+  BigInt remainder;
+  DivMod(*this, other, &quotient, &remainder);
+  return remainder;
+}
+
+BigInt operator*(const BigInt& lhs, const BigInt& rhs) {
+  ArenaScope scope(lhs.x_, rhs.x_);
+  BigInt right;
+  if (lhs.x_.empty() || rhs.x_.empty()) {
+    return right;
+  }
+  size_t size = lhs.x_.size() + rhs.x_.size();
+  if (size <= kSmallProductLimbs) {
+    uint64_t product[kSmallProductLimbs];
+    MulSchoolbook(product, lhs.x_.data(), lhs.x_.size(), rhs.x_.data(),
+                  rhs.x_.size());
+    right.x_.assign(product, product + limbs::Normalize(product, size));
+  } else {
+    right.x_.resize(size);
+    MulAbs(right.x_.data(), lhs.x_.data(), lhs.x_.size(), rhs.x_.data(),
+           rhs.x_.size(), thread_count);
   }
-  return res;
+  right.sign_ = lhs.sign_ ^ rhs.sign_;
+  right.DeleteZeros();
+  return right;
 }
 
-BigInt operator/(const BigInt& left, const BigInt& right) {
-  if (right == 0) {
-    std::cout << "-1!\n";
-    return 0;
+BigInt BigInt::Square() const { return *this * *this; }
+
+std::istream& operator>>(std::istream& input, BigInt& rhs) {
+  std::istream::sentry sentry(input);
+  if (!sentry) {
+    return input;
   }
-  BigInt b_right = right;
-  b_right.sign_ = false;
-  BigInt res;
-  BigInt cur;
-  for (size_t i = 0; i < left.x_.size(); ++i) {
-    cur.x_.push_back(left.x_[i]);
-    int64_t elem = 0;
-    int64_t left_pointer = 0;
-    int64_t right_pointer = kName;
-    while (left_pointer <= right_pointer) {
-      int64_t mid = (left_pointer + right_pointer) / 2;
-      if (b_right * mid <= cur) {
-        elem = mid;
-        left_pointer = mid + 1;
+  // The digits are taken straight from the stream buffer into a buffer kept
+  // for the next call, then converted in one go.
+  thread_local std::string digits;
+  digits.clear();
+  std::streambuf* buf = input.rdbuf();
+  int c = buf->sgetc();
+  bool negative = c == '-';
+  if (negative) {
+    c = buf->snextc();
+  }
+  while (c >= '0' && c <= '9') {
+    digits.push_back(static_cast<char>(c));
+    c = buf->snextc();
+  }
+  std::ios_base::iostate state = std::ios_base::goodbit;
+  if (c == std::char_traits<char>::eof()) {
+    state |= std::ios_base::eofbit;
+  }
+  if (digits.empty()) {
+    state |= std::ios_base::failbit;
+    rhs.Clear();
+  } else {
+    ArenaScope scope(rhs.x_);
+    rhs.x_ = ParseDigits(digits.data(), digits.size(), thread_count);
+    rhs.sign_ = negative;
+    rhs.DeleteZeros();
+  }
+  if (digits.capacity() > kMaxStreamBufferChars) {
+    std::string().swap(digits);
+  }
+  input.setstate(state);
+  return input;
+}
+
+std::ostream& operator<<(std::ostream& outstream, const BigInt& rhs) {
+  char text[kStackDecimalChars];
+  thread_local std::string buffer;
+  std::string local;
+  const char* begin;
+  const char* end;
+  if (rhs.x_.size() <= LimbVector::kInlineLimbs) {
+    end = text + kStackDecimalChars;
+    char* first = WriteSmallDecimal(rhs.x_, text + kStackDecimalChars);
+    if (rhs.sign_) {
+      *--first = '-';
+    }
+    begin = first;
+  } else {
+    ArenaScope scope(rhs.x_);
+    std::string* out =
+        rhs.x_.size() <= kMaxStreamBufferLimbs ? &buffer : &local;
+    size_t first = AppendDigits(rhs.x_, 1, out);
+    if (rhs.sign_) {
+      (*out)[--first] = '-';
+    }
+    begin = out->data() + first;
+    end = out->data() + out->size();
+  }
+  std::streamsize len = end - begin;
+  // A field width needs the formatted path for its padding.
+  if (outstream.width() != 0) {
+    return outstream << std::string(begin, end);
+  }
+  std::ostream::sentry sentry(outstream);
+  if (sentry && outstream.rdbuf()->sputn(begin, len) != len) {
+    outstream.setstate(std::ios_base::badbit);
+  }
+  return outstream;
+}
+
+MontgomeryContext::MontgomeryContext(const BigInt& mod) : mod_(mod.x_) {
+  uint64_t inv = mod_[0];
+  for (int i = 0; i < 5; ++i) {
+    inv *= 2 - mod_[0] * inv;
+  }
+  neg_inv_ = 0 - inv;
+  size_t k = mod_.size();
+  LimbVector quot;
+  LimbVector power(k + 1, 0);
+  power[k] = 1;
+  DivModVec(power, mod_, &quot, &one_);
+  one_.resize(k, 0);
+  power.assign(2 * k + 1, 0);
+  power[2 * k] = 1;
+  DivModVec(power, mod_, &quot, &r2_);
+  r2_.resize(k, 0);
+}
+
+void MontgomeryContext::Reduce(uint64_t* t, uint64_t* out) const {
+  size_t k = mod_.size();
+  for (size_t i = 0; i < k; ++i) {
+    uint64_t carry = limbs::AddMul1(t + i, mod_.data(), k, t[i] * neg_inv_);
+    limbs::Add1(t + i + k, t + i + k, k + 1 - i, carry);
+  }
+  // t / R < 2n here.
+  uint64_t* res = t + k;
+  size_t i = k;
+  while (i > 0 && res[i - 1] == mod_[i - 1]) {
+    --i;
+  }
+  if (res[k] != 0 || i == 0 || res[i - 1] > mod_[i - 1]) {
+    limbs::Sub(res, res, k + 1, mod_.data(), k);
+  }
+  std::copy(res, res + k, out);
+}
+
+void MontgomeryContext::Multiply(const uint64_t* a, const uint64_t* b,
+                                 uint64_t* out, uint64_t* scratch) const {
+  size_t k = mod_.size();
+  MulAbs(scratch, a, k, b, k);
+  scratch[2 * k] = 0;
+  Reduce(scratch, out);
+}
+
+BigInt MontgomeryContext::Pow(const BigInt& base, const BigInt& exp) const {
+  ArenaScope scope(base.x_, exp.x_);
+  size_t k = mod_.size();
+  LimbVector scratch(2 * k + 1);
+  LimbVector x = ReduceResidue(base.x_, base.sign_, mod_);
+  x.resize(k, 0);
+  Multiply(x.data(), r2_.data(), x.data(), scratch.data());
+  LimbVector res = one_;
+  size_t bits = BitLength(exp.x_);
+  if (bits != 0) {
+    size_t width = WindowBits(bits);
+    // table[i] = x^(2i + 1) in Montgomery form.
+    std::vector<LimbVector> table(size_t(1) << (width - 1), x);
+    LimbVector square(k);
+    Multiply(x.data(), x.data(), square.data(), scratch.data());
+    for (size_t i = 1; i < table.size(); ++i) {
+      Multiply(table[i - 1].data(), square.data(), table[i].data(),
+               scratch.data());
+    }
+    bool started = false;
+    for (size_t top = bits; top-- > 0;) {
+      if (!TestBit(exp.x_, top)) {
+        Multiply(res.data(), res.data(), res.data(), scratch.data());
+        continue;
+      }
+      // The window is exp[low, top] with both ends set.
+      size_t low = top + 1 >= width ? top + 1 - width : 0;
+      while (!TestBit(exp.x_, low)) {
+        ++low;
+      }
+      size_t window = 0;
+      for (size_t i = top + 1; i-- > low;) {
+        window = 2 * window + (TestBit(exp.x_, i) ? 1 : 0);
+      }
+      if (started) {
+        for (size_t i = low; i <= top; ++i) {
+          Multiply(res.data(), res.data(), res.data(), scratch.data());
+        }
+        Multiply(res.data(), table[window / 2].data(), res.data(),
+                 scratch.data());
       } else {
-        right_pointer = mid - 1;
+        res = table[window / 2];
+        started = true;
       }
+      top = low;
     }
-    res.x_.push_back(elem);
-    cur = cur - b_right * BigInt(elem);
-    if (cur.x_[0] == 0) {
-      cur.x_.clear();
+  }
+  std::fill(scratch.begin(), scratch.end(), 0);
+  std::copy(res.begin(), res.end(), scratch.begin());
+  Reduce(scratch.data(), res.data());
+  BigInt result;
+  result.x_ = std::move(res);
+  result.DeleteZeros();
+  return result;
+}
+
+BigInt PowMod(const BigInt& base, const BigInt& exp, const BigInt& mod) {
+  ArenaScope scope(base.x_, exp.x_);
+  if (mod.x_.empty() || exp.sign_) {
+    std::cout << "-1!\n";
+    return BigInt();
+  }
+  if ((mod.x_[0] & 1) != 0) {
+    return MontgomeryContext(mod).Pow(base, exp);
+  }
+  // Even moduli have no Montgomery form: square and multiply with division.
+  BigInt modulus;
+  modulus.x_ = mod.x_;
+  BigInt power;
+  power.x_ = ReduceResidue(base.x_, base.sign_, mod.x_);
+  BigInt res = BigInt(1) % modulus;
+  for (size_t bit = BitLength(exp.x_); bit-- > 0;) {
+    res = res * res % modulus;
+    if (TestBit(exp.x_, bit)) {
+      res = res * power % modulus;
     }
   }
-  return Div(left, right, res);
+  return res;
 }
 
-BigInt& BigInt::operator/=(const BigInt& other) {
-  BigInt& result = *this;
-  result = result / other;
-  return result;
+BigInt Gcd(const BigInt& a, const BigInt& b) {
+  ArenaScope scope(a.x_, b.x_);
+  BigInt res;
+  if (a.x_.empty() || b.x_.empty()) {
+    res.x_ = a.x_.empty() ? b.x_ : a.x_;
+  } else {
+    res.x_ = GcdAbs(a.x_, b.x_, nullptr);
+  }
+  return res;
 }
 
-BigInt& BigInt::operator%=(const BigInt& other) {
-  *this = *this - (*this / other) * other;
-  return *this;
+BigInt Lcm(const BigInt& a, const BigInt& b) {
+  ArenaScope scope(a.x_, b.x_);
+  BigInt res;
+  if (a.x_.empty() || b.x_.empty()) {
+    return res;
+  }
+  LimbVector quot;
+  LimbVector rem;
+  DivModVec(a.x_, GcdAbs(a.x_, b.x_, nullptr), &quot, &rem);
+  res.x_ = MulVec(quot, b.x_);
+  return res;
 }
 
-BigInt BigInt::operator%(const BigInt& other) const {
-  BigInt copy = *this;
-  copy %= other;
-  return copy;
+BigInt ExtendedGcd(const BigInt& a, const BigInt& b, BigInt* x, BigInt* y) {
+  ArenaScope scope(a.x_, b.x_);
+  BigInt g;
+  BigInt x_res;
+  BigInt y_res;
+  if (a.x_.empty()) {
+    g.x_ = b.x_;
+    if (!b.x_.empty()) {
+      y_res = b.sign_ ? -1 : 1;
+    }
+  } else if (b.x_.empty()) {
+    g.x_ = a.x_;
+    x_res = a.sign_ ? -1 : 1;
+  } else {
+    // (|a|, |b|) = M (g, g) with det M = 1, so g = m11 |a| - m01 |b|.
+    GcdMatrix M = IdentityMatrix();
+    g.x_ = GcdAbs(a.x_, b.x_, &M);
+    x_res.x_ = std::move(M.m[1][1]);
+    x_res.sign_ = a.sign_;
+    x_res.DeleteZeros();
+    y_res.x_ = std::move(M.m[0][1]);
+    y_res.sign_ = !b.sign_;
+    y_res.DeleteZeros();
+  }
+  *x = std::move(x_res);
+  *y = std::move(y_res);
+  return g;
 }
 
-BigInt operator*(const BigInt& lhs, const BigInt& rhs) {
-  BigInt right = BigInt(0);
-  BigInt lhs1 = lhs;
-  BigInt rhs1 = rhs;
-  reverse(lhs1.x_.begin(), lhs1.x_.end());
-  reverse(rhs1.x_.begin(), rhs1.x_.end());
-  right.x_.resize(lhs.x_.size() + rhs.x_.size());
-  for (size_t i = 0; i < lhs.x_.size(); i++) {
-    for (size_t j = 0; j < rhs.x_.size(); j++) {
-      right.x_[i + j] += lhs1.x_[i] * rhs1.x_[j];
+BigInt ISqrt(const BigInt& x) {
+  ArenaScope scope(x.x_);
+  if (x.sign_) {
+    std::cout << "-1!\n";
+    return BigInt();
+  }
+  BigInt res;
+  res.x_ = SqrtAbs(x.x_);
+  return res;
+}
+
+BigInt IRoot(const BigInt& x, uint64_t k) {
+  ArenaScope scope(x.x_);
+  if (k == 0 || (x.sign_ && k % 2 == 0)) {
+    std::cout << "-1!\n";
+    return BigInt();
+  }
+  if (k == 1 || x.x_.empty()) {
+    return x;
+  }
+  BigInt res;
+  res.x_ = k == 2 ? SqrtAbs(x.x_) : RootAbs(x.x_, k);
+  res.sign_ = x.sign_;
+  return res;
+}
+
+BigInt Product(const std::vector<BigInt>& values) {
+  LimbArena* arena = nullptr;
+  for (const auto& value : values) {
+    if (value.x_.arena() != nullptr) {
+      arena = value.x_.arena();
+      break;
+    }
+  }
+  ArenaScope scope(arena);
+  std::vector<LimbVector> leaves;
+  bool negative = false;
+  for (const auto& value : values) {
+    if (value.x_.empty()) {
+      return BigInt();
+    }
+    leaves.push_back(value.x_);
+    negative = negative != value.sign_;
+  }
+  BigInt res;
+  res.x_ = ProductOf(leaves, thread_count);
+  res.sign_ = negative;
+  return res;
+}
+
+BigInt Factorial(uint64_t n) {
+  BigInt res;
+  res.x_ = FactorialAbs(n, thread_count);
+  return res;
+}
+
+BigInt Binomial(uint64_t n, uint64_t k) {
+  BigInt res;
+  if (k > n) {
+    return res;
+  }
+  k = std::min(k, n - k);
+  if (n / kFallingBinomialRatio > k) {
+    std::vector<uint64_t> factors;
+    for (uint64_t i = 0; i < k; ++i) {
+      factors.push_back(n - i);
     }
+    LimbVector rem;
+    DivModVec(ProductOf(PackWords(factors), thread_count),
+              FactorialAbs(k, thread_count), &res.x_, &rem);
+    return res;
   }
-  for (size_t i = 0; i < right.x_.size(); i++) {
-    if (right.x_[i] >= kName) {
-      right.x_[i + 1] += right.x_[i] / kName;
-      right.x_[i] %= kName;
+  // Kummer: the exponent of p is the number of borrows when subtracting k
+  // from n in base p.
+  std::vector<uint64_t> primes = PrimesUpTo(n);
+  std::vector<uint64_t> exps;
+  for (uint64_t p : primes) {
+    uint64_t e = 0;
+    for (uint64_t a = n / p, b = k / p, c = (n - k) / p; a > 0;
+         a /= p, b /= p, c /= p) {
+      e += a - b - c;
     }
+    exps.push_back(e);
   }
-  while (right.x_.size() > 1 && right.x_.back() == 0) {
-    right.x_.pop_back();
+  res.x_ = PrimePowerProduct(primes, exps, thread_count);
+  return res;
+}
+
+Reducer::Reducer(const BigInt& mod) : mod_(mod, nullptr) {
+  mod_.sign_ = false;
+  if (mod_.x_.size() >= kBarrettThreshold) {
+    inv_ = Reciprocal(mod_.x_);
   }
-  right.sign_ = lhs.sign_ ^ rhs.sign_;
-  reverse(right.x_.begin(), right.x_.end());
-  if (right.x_[0] == 0) {
-    right.sign_ = false;
+}
+
+bool BinaryReader::Next(BigIntView* view) {
+  if (pos_ == end_) {
+    return false;
   }
-  return right;
+  uint64_t size = *pos_ >> 1;
+  if (size > static_cast<uint64_t>(end_ - pos_ - 1)) {
+    return false;
+  }
+  view->negative = (*pos_ & 1) != 0;
+  view->limbs = pos_ + 1;
+  view->size = size;
+  pos_ += 1 + size;
+  return true;
 }
 
-std::istream& operator>>(std::istream& input, BigInt& rhs) {
-  std::string str;
-  input >> str;
-  rhs = BigInt(str);
-  return input;
+bool BinaryReader::Next(BigInt* value) {
+  BigIntView view;
+  if (!Next(&view)) {
+    return false;
+  }
+  *value = BigInt(view);
+  return true;
 }
-std::ostream& operator<<(std::ostream& outstream, const BigInt& rhs) {
-  if (rhs.sign_) {
-    outstream << '-';
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
   }
-  for (size_t i = 0; i < rhs.x_.size(); ++i) {
-    outstream << rhs.x_[i];
+  struct stat info;
+  if (fstat(fd, &info) == 0) {
+    bytes_ = info.st_size;
+    if (bytes_ == 0) {
+      open_ = true;
+    } else {
+      void* map = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED) {
+        data_ = static_cast<const uint64_t*>(map);
+        open_ = true;
+      } else {
+        bytes_ = 0;
+      }
+    }
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint64_t*>(data_), bytes_);
   }
-  return outstream;
 }
@@ -1,26 +1,242 @@
 #pragma once
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+class ArenaScope;
+class LimbArena;
+
+// Limb buffer of a BigInt with a std::vector-like interface. Up to
+// kInlineLimbs limbs are stored in the object itself; longer values spill to
+// the heap, or to the LimbArena the vector belongs to. A new vector belongs
+// to the arena of the operation that creates it, if any.
+class LimbVector {
+ public:
+  static const size_t kInlineLimbs = 2;
+  using iterator = uint64_t*;
+  using const_iterator = const uint64_t*;
+
+  LimbVector() : arena_(current_arena_) {}
+  explicit LimbVector(size_t size, uint64_t value = 0);
+  template <typename Iter, typename = typename std::enable_if<
+                               !std::is_integral<Iter>::value>::type>
+  LimbVector(Iter first, Iter last) : arena_(current_arena_) {
+    assign(first, last);
+  }
+  LimbVector(const LimbVector& other);
+  // A copy of other in arena (nullptr: on the heap).
+  LimbVector(const LimbVector& other, LimbArena* arena);
+  // Takes over the buffer and the arena of other, so it never allocates.
+  LimbVector(LimbVector&& other) noexcept;
+  LimbVector& operator=(const LimbVector& other);
+  // Takes the buffer of other unless it lives in an arena this vector does
+  // not belong to. Then the limbs are copied, which may allocate.
+  LimbVector& operator=(LimbVector&& other);
+  ~LimbVector();
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+  uint64_t* data() { return data_; }
+  const uint64_t* data() const { return data_; }
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  uint64_t& operator[](size_t index) { return data_[index]; }
+  const uint64_t& operator[](size_t index) const { return data_[index]; }
+  uint64_t& back() { return data_[size_ - 1]; }
+  const uint64_t& back() const { return data_[size_ - 1]; }
+
+  void push_back(uint64_t limb) {
+    if (size_ == capacity_) {
+      Grow(size_ + 1);
+    }
+    data_[size_++] = limb;
+  }
+  void pop_back() { --size_; }
+  void clear() { size_ = 0; }
+  void resize(size_t size, uint64_t value = 0);
+  void reserve(size_t capacity);
+  void assign(size_t size, uint64_t value);
+  template <typename Iter, typename = typename std::enable_if<
+                               !std::is_integral<Iter>::value>::type>
+  void assign(Iter first, Iter last) {
+    size_ = 0;
+    reserve(std::distance(first, last));
+    size_ = std::copy(first, last, data_) - data_;
+  }
+  iterator insert(const_iterator pos, size_t count, uint64_t value);
+  template <typename Iter, typename = typename std::enable_if<
+                               !std::is_integral<Iter>::value>::type>
+  iterator insert(const_iterator pos, Iter first, Iter last) {
+    size_t offset = pos - data_;
+    size_t count = std::distance(first, last);
+    iterator gap = insert(pos, count, 0);
+    std::copy(first, last, gap);
+    return data_ + offset;
+  }
+  iterator erase(const_iterator first, const_iterator last);
+  void swap(LimbVector& other);
+
+  // Arena that holds the buffer, or that a vector with inline limbs will
+  // spill to; nullptr for the heap.
+  LimbArena* arena() const { return arena_; }
+
+  // Number of heap buffers allocated by all LimbVectors so far. Buffers
+  // taken from an arena are not counted.
+  static size_t AllocationCount();
+
+ private:
+  friend class ArenaScope;
+  // Moves the limbs to a buffer of the given capacity. This is the only
+  // place that allocates. The buffer comes from the vector's arena while an
+  // operation on that arena runs on this thread, and from the heap
+  // otherwise; the vector then leaves the arena.
+  void Reallocate(size_t capacity);
+  // Reallocates with geometric growth to hold at least size limbs.
+  void Grow(size_t size);
+  // Frees a heap buffer; arena buffers go away with their arena.
+  void Release();
+  bool IsInline() const { return data_ == inline_; }
+
+  // Arena of the operation running on this thread, see ArenaScope.
+  static thread_local LimbArena* current_arena_;
+
+  uint64_t* data_ = inline_;
+  size_t size_ = 0;
+  size_t capacity_ = kInlineLimbs;
+  LimbArena* arena_;
+  uint64_t inline_[kInlineLimbs];
+};
+
+bool operator==(const LimbVector& lhs, const LimbVector& rhs);
+
+// Bump allocator for the limbs of BigInt values in a batch computation.
+// Values opt in with BigInt(value, &arena). Every operation on such a value
+// then takes the limbs of its result and of its temporaries from the same
+// arena (the left operand's if the operands differ), so a loop over arena
+// values does not touch the heap. Nothing is freed individually: Reset()
+// releases everything at once and invalidates every value in the arena.
+//
+// Values leave the arena by copying. A copy-constructed BigInt, or an
+// assignment to a BigInt outside the arena, puts the limbs on the heap.
+// Moves keep the arena. An arena and its values are used by one thread at
+// a time; the parts of an operation that SetThreadCount hands to other
+// threads allocate on the heap.
+class LimbArena {
+ public:
+  static const size_t kDefaultBlockLimbs = size_t(1) << 16;
+
+  explicit LimbArena(size_t block_limbs = kDefaultBlockLimbs)
+      : block_limbs_(block_limbs) {}
+  LimbArena(const LimbArena&) = delete;
+  LimbArena& operator=(const LimbArena&) = delete;
+
+  // Invalidates every value in the arena. One block large enough for all
+  // that was allocated since the last Reset() is kept, so a batch of the
+  // same shape runs again without allocating.
+  void Reset();
+
+ private:
+  friend class LimbVector;
+  struct Block {
+    std::unique_ptr<uint64_t[]> data;
+    size_t size;
+  };
+
+  uint64_t* Allocate(size_t limbs);
+
+  size_t block_limbs_;
+  std::vector<Block> blocks_;
+  uint64_t* pos_ = nullptr;
+  uint64_t* end_ = nullptr;
+};
+
+class Reducer;
+template <size_t Bits>
+class FixedInt;
+
+// A serialized value read in place: limbs[0, size) is the magnitude, least
+// significant limb first, and stays in the caller's buffer.
+struct BigIntView {
+  const uint64_t* limbs = nullptr;
+  size_t size = 0;
+  bool negative = false;
+};
+
 class BigInt {
  private:
-  static const int kBase = 1000000000;
   bool sign_ = false;
-  std::vector<uint64_t> x_;
+  // Magnitude in base 2^64, least significant limb first, no leading zero
+  // limbs. Zero is an empty vector.
+  LimbVector x_;
   friend BigInt Sum(const BigInt& lhs, const BigInt& rhs);
   friend BigInt Sub(const BigInt& lhs, const BigInt& rhs);
-  friend BigInt Div(const BigInt& left, const BigInt& right,
-                    const BigInt& b_right);
+  friend BigInt SignedSum(const BigInt& lhs, const BigInt& rhs,
+                          bool rhs_sign);
+  // *this += (rhs_sign ? -|rhs| : |rhs|) in the existing limb buffer.
+  void Accumulate(const BigInt& rhs, bool rhs_sign);
+  // *this += lhs * rhs, negated if negate.
+  void MulAccumulate(const BigInt& lhs, const BigInt& rhs, bool negate);
+  friend class MontgomeryContext;
+  friend class Reducer;
+  template <size_t Bits>
+  friend class FixedInt;
+  friend BigInt PowMod(const BigInt& base, const BigInt& exp,
+                       const BigInt& mod);
+  friend BigInt Gcd(const BigInt& a, const BigInt& b);
+  friend BigInt Lcm(const BigInt& a, const BigInt& b);
+  friend BigInt ExtendedGcd(const BigInt& a, const BigInt& b, BigInt* x,
+                            BigInt* y);
+  friend BigInt ISqrt(const BigInt& x);
+  friend BigInt IRoot(const BigInt& x, uint64_t k);
+  friend BigInt Product(const std::vector<BigInt>& values);
+  friend BigInt Factorial(uint64_t n);
+  friend BigInt Binomial(uint64_t n, uint64_t k);
+  // Kernels of the integral overloads below, for the operand abs negated
+  // if negative: one pass over the limbs and no BigInt for the operand.
+  void AccumulateLimb(uint64_t abs, bool negative);
+  void MulLimb(uint64_t abs, bool negative);
+  void DivLimb(uint64_t abs, bool negative);
+  BigInt RemLimb(uint64_t abs) const;
+  template <typename T>
+  using IfIntegral = typename std::enable_if<
+      std::is_integral<T>::value && !std::is_same<T, bool>::value,
+      int>::type;
+  template <typename T>
+  using Widened = typename std::conditional<std::is_signed<T>::value,
+                                            int64_t, uint64_t>::type;
+  static uint64_t Magnitude(int64_t num) {
+    return num < 0 ? 0 - static_cast<uint64_t>(num) : num;
+  }
+  static uint64_t Magnitude(uint64_t num) { return num; }
+  static bool IsNegative(int64_t num) { return num < 0; }
+  static bool IsNegative(uint64_t) { return false; }
 
  public:
   BigInt();
   BigInt(int64_t num);
   BigInt(const std::string& str);
+  // Copies the limbs of view; leading zero limbs are dropped.
+  explicit BigInt(const BigIntView& view);
+  // A copy of value in arena, or on the heap for nullptr. See LimbArena.
+  BigInt(const BigInt& value, LimbArena* arena);
   BigInt operator+() const;
-  BigInt operator-() const;
+  BigInt operator-() const&;
+  BigInt operator-() &&;
   std::string ToString() const;
+  // Binary form: one header word (limb count << 1 | sign) followed by the
+  // limbs, least significant first, in host byte order. BinaryWords() is
+  // its length in words; WriteBinary(out) returns the end of what it wrote.
+  size_t BinaryWords() const;
+  uint64_t* WriteBinary(uint64_t* out) const;
+  void WriteBinary(std::ostream& out) const;
   bool operator<(const BigInt& rhs) const;
   bool operator==(const BigInt& rhs) const;
   bool operator!=(const BigInt& rhs) const;
@@ -31,20 +247,340 @@ class BigInt {
   void Clear();
   friend BigInt operator+(const BigInt& lhs, const BigInt& rhs);
   friend BigInt operator-(const BigInt& lhs, const BigInt& rhs);
+  // Overloads for temporaries reuse their limb buffer, so a chain like
+  // a + b - c + d or a * b + c builds a single result in place.
+  friend BigInt operator+(BigInt&& lhs, const BigInt& rhs);
+  friend BigInt operator+(const BigInt& lhs, BigInt&& rhs);
+  friend BigInt operator+(BigInt&& lhs, BigInt&& rhs);
+  friend BigInt operator-(BigInt&& lhs, const BigInt& rhs);
+  friend BigInt operator-(const BigInt& lhs, BigInt&& rhs);
+  friend BigInt operator-(BigInt&& lhs, BigInt&& rhs);
+  // x * x is detected and squared like Square(), which forms each cross
+  // product once.
   friend BigInt operator*(const BigInt& lhs, const BigInt& rhs);
   friend BigInt operator/(const BigInt& left, const BigInt& right);
+  // Truncating division: the remainder takes the sign of left.
+  friend void DivMod(const BigInt& left, const BigInt& right,
+                     BigInt* quotient, BigInt* remainder);
   BigInt& operator%=(const BigInt& other);
+  // Same result as %= with the reducer's modulus.
+  BigInt& operator%=(const Reducer& reducer);
   BigInt operator%(const BigInt& other) const;
   BigInt& operator/=(const BigInt& other);
   BigInt& operator+=(const BigInt& rhs);
   BigInt& operator-=(const BigInt& rhs);
   BigInt& operator*=(const BigInt& rhs);
-  BigInt operator++();
-  BigInt operator--();
+  // Integral operands go through single-limb kernels instead of being
+  // converted to a BigInt. The result type and rounding are as for BigInt
+  // operands.
+  template <typename T, IfIntegral<T> = 0>
+  BigInt& operator+=(T rhs) {
+    AccumulateLimb(Magnitude(Widened<T>(rhs)), IsNegative(Widened<T>(rhs)));
+    return *this;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  BigInt& operator-=(T rhs) {
+    AccumulateLimb(Magnitude(Widened<T>(rhs)), !IsNegative(Widened<T>(rhs)));
+    return *this;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  BigInt& operator*=(T rhs) {
+    MulLimb(Magnitude(Widened<T>(rhs)), IsNegative(Widened<T>(rhs)));
+    return *this;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  BigInt& operator/=(T rhs) {
+    DivLimb(Magnitude(Widened<T>(rhs)), IsNegative(Widened<T>(rhs)));
+    return *this;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  BigInt& operator%=(T rhs) {
+    *this = RemLimb(Magnitude(Widened<T>(rhs)));
+    return *this;
+  }
+  // A temporary operand is updated in place. Any other is copied first,
+  // into its own arena so that the result stays there.
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator+(const BigInt& lhs, T rhs) {
+    return BigInt(lhs, lhs.x_.arena()) + rhs;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator+(BigInt&& lhs, T rhs) {
+    lhs += rhs;
+    return std::move(lhs);
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator+(T lhs, const BigInt& rhs) {
+    return lhs + BigInt(rhs, rhs.x_.arena());
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator+(T lhs, BigInt&& rhs) {
+    rhs += lhs;
+    return std::move(rhs);
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator-(const BigInt& lhs, T rhs) {
+    return BigInt(lhs, lhs.x_.arena()) - rhs;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator-(BigInt&& lhs, T rhs) {
+    lhs -= rhs;
+    return std::move(lhs);
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator-(T lhs, const BigInt& rhs) {
+    return lhs - BigInt(rhs, rhs.x_.arena());
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator-(T lhs, BigInt&& rhs) {
+    rhs = -std::move(rhs);
+    rhs += lhs;
+    return std::move(rhs);
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator*(const BigInt& lhs, T rhs) {
+    return BigInt(lhs, lhs.x_.arena()) * rhs;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator*(BigInt&& lhs, T rhs) {
+    lhs *= rhs;
+    return std::move(lhs);
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator*(T lhs, const BigInt& rhs) {
+    return lhs * BigInt(rhs, rhs.x_.arena());
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator*(T lhs, BigInt&& rhs) {
+    rhs *= lhs;
+    return std::move(rhs);
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator/(const BigInt& lhs, T rhs) {
+    return BigInt(lhs, lhs.x_.arena()) / rhs;
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator/(BigInt&& lhs, T rhs) {
+    lhs /= rhs;
+    return std::move(lhs);
+  }
+  template <typename T, IfIntegral<T> = 0>
+  friend BigInt operator%(const BigInt& lhs, T rhs) {
+    return lhs.RemLimb(Magnitude(Widened<T>(rhs)));
+  }
+  // *this += lhs * rhs and *this -= lhs * rhs. Below the Karatsuba size the
+  // product rows are added straight into *this, with no temporary.
+  BigInt& AddMul(const BigInt& lhs, const BigInt& rhs);
+  BigInt& SubMul(const BigInt& lhs, const BigInt& rhs);
+  BigInt Square() const;
+  BigInt& operator++();
+  BigInt& operator--();
   BigInt operator++(int other);
   BigInt operator--(int other);
   friend std::istream& operator>>(std::istream& input, BigInt& rhs);
   friend std::ostream& operator<<(std::ostream& outstream, const BigInt& rhs);
   void DeleteZeros();
+  // Used to pad the digits with a leading zero, which left the value
+  // unchanged. The limbs are kept without leading zeros, so this does
+  // nothing.
   void ShiftRight();
+  // Threads that very large multiplications and conversions may use,
+  // counting the calling thread; 1 (the default) keeps all work on it. The
+  // other count - 1 threads are started here and reused by every later call.
+  static void SetThreadCount(size_t count);
+};
+
+// base^exp mod |mod|, in [0, |mod|). Requires exp >= 0 and mod != 0.
+BigInt PowMod(const BigInt& base, const BigInt& exp, const BigInt& mod);
+
+// Greatest common divisor of |a| and |b|; Gcd(0, 0) is 0. Lehmer's algorithm
+// with single-limb cofactors, and a recursive half-GCD for very large inputs.
+BigInt Gcd(const BigInt& a, const BigInt& b);
+// Least common multiple of |a| and |b|; 0 if either is 0.
+BigInt Lcm(const BigInt& a, const BigInt& b);
+// Returns g = Gcd(a, b) and sets a * x + b * y = g with |x| <= |b| / g and
+// |y| <= |a| / g (x is 0 if a is, y is 0 if only b is).
+BigInt ExtendedGcd(const BigInt& a, const BigInt& b, BigInt* x, BigInt* y);
+
+// floor(sqrt(x)). Requires x >= 0. Newton's iteration seeded from the FPU
+// and doubling its precision each step, about the cost of two divisions.
+BigInt ISqrt(const BigInt& x);
+// The k-th root of |x| rounded down, with the sign of x. Requires k >= 1,
+// and x >= 0 for even k.
+BigInt IRoot(const BigInt& x, uint64_t k);
+
+// Product of all values (1 for none) by a balanced product tree, so the
+// large multiplications see operands of similar size and reach the
+// subquadratic algorithms.
+BigInt Product(const std::vector<BigInt>& values);
+template <typename Iterator>
+BigInt Product(Iterator first, Iterator last) {
+  return Product(std::vector<BigInt>(first, last));
+}
+// n!, from its prime factorization: the prime powers are grouped by
+// exponent bit and combined with product trees and squarings.
+BigInt Factorial(uint64_t n);
+// n choose k, 0 if k > n. Uses the same prime factorization unless k is
+// much smaller than n.
+BigInt Binomial(uint64_t n, uint64_t k);
+
+// The value of the integer literal spelled by Chars, parsed at compile time
+// into limbs with static storage duration. Accepts the decimal, 0x, 0b and
+// octal forms and ' separators, like the built-in literals.
+template <char... Chars>
+class BigIntLiteral {
+ public:
+  // A view of the static limbs; nothing is copied.
+  static constexpr BigIntView View() {
+    static_assert(kValue.valid, "_big takes an integer literal");
+    return BigIntView{kValue.limbs, kValue.size, false};
+  }
+
+ private:
+  static constexpr size_t kLength = sizeof...(Chars);
+  static constexpr char kChars[kLength] = {Chars...};
+  static constexpr uint64_t kBase =
+      kLength > 1 && kChars[0] == '0'
+          ? (kChars[1] == 'x' || kChars[1] == 'X'
+                 ? 16
+                 : kChars[1] == 'b' || kChars[1] == 'B' ? 2 : 8)
+          : 10;
+  static constexpr size_t kPrefix = kBase == 16 || kBase == 2 ? 2
+                                    : kBase == 8              ? 1
+                                                              : 0;
+  // At most 4 bits per digit for bases up to 16.
+  static constexpr size_t kMaxLimbs = kLength * 4 / 64 + 1;
+
+  struct Parsed {
+    uint64_t limbs[kMaxLimbs];
+    size_t size;
+    bool valid;
+  };
+
+  static constexpr uint64_t Digit(char c) {
+    return c >= '0' && c <= '9'   ? static_cast<uint64_t>(c - '0')
+           : c >= 'a' && c <= 'f' ? static_cast<uint64_t>(c - 'a' + 10)
+           : c >= 'A' && c <= 'F' ? static_cast<uint64_t>(c - 'A' + 10)
+                                  : 16;
+  }
+  static constexpr Parsed Parse() {
+    Parsed res{{}, 0, true};
+    for (size_t i = kPrefix; i < kLength; ++i) {
+      if (kChars[i] == '\'') {
+        continue;
+      }
+      uint64_t carry = Digit(kChars[i]);
+      if (carry >= kBase) {
+        res.valid = false;
+        return res;
+      }
+      for (size_t j = 0; j < res.size; ++j) {
+        unsigned __int128 cur =
+            static_cast<unsigned __int128>(res.limbs[j]) * kBase + carry;
+        res.limbs[j] = static_cast<uint64_t>(cur);
+        carry = static_cast<uint64_t>(cur >> 64);
+      }
+      if (carry != 0) {
+        res.limbs[res.size++] = carry;
+      }
+    }
+    return res;
+  }
+
+  static constexpr Parsed kValue = Parse();
+};
+
+template <char... Chars>
+constexpr char BigIntLiteral<Chars...>::kChars[];
+template <char... Chars>
+constexpr typename BigIntLiteral<Chars...>::Parsed
+    BigIntLiteral<Chars...>::kValue;
+
+// 123456789012345678901234567890_big: the limbs are computed by the
+// compiler, and building the BigInt copies them once (not at all into the
+// heap for values of up to kInlineLimbs limbs).
+template <char... Chars>
+BigInt operator""_big() {
+  return BigInt(BigIntLiteral<Chars...>::View());
+}
+
+// Montgomery arithmetic modulo a fixed odd modulus n, with R = 2^(64k) for
+// a k-limb n. Building the context takes two divisions (R mod n and
+// R^2 mod n); exponentiations of bases below n need none after that.
+class MontgomeryContext {
+ public:
+  // Requires mod odd; its sign is ignored.
+  explicit MontgomeryContext(const BigInt& mod);
+  // base^exp mod n by sliding-window exponentiation. Requires exp >= 0.
+  BigInt Pow(const BigInt& base, const BigInt& exp) const;
+
+ private:
+  // out[0, k) = a * b / R mod n for a, b < n. scratch holds 2k + 1 limbs;
+  // out may alias a or b.
+  void Multiply(const uint64_t* a, const uint64_t* b, uint64_t* out,
+                uint64_t* scratch) const;
+  // out[0, k) = t / R mod n for t[0, 2k + 1) < n * R. Clobbers t.
+  void Reduce(uint64_t* t, uint64_t* out) const;
+
+  LimbVector mod_;
+  // -n^-1 mod 2^64.
+  uint64_t neg_inv_;
+  LimbVector one_;
+  LimbVector r2_;
+};
+
+// Barrett reduction by a fixed nonzero modulus m: keeps floor(B^(2k) / m)
+// for a k-limb m (B = 2^64), or a value at most four below it for very long
+// m, so that reducing a value of up to 2k limbs takes two multiplications
+// and a few subtractions. Longer values
+// are reduced k limbs at a time; moduli of only a few limbs use plain %,
+// which is faster there.
+class Reducer {
+ public:
+  // The sign of mod is ignored.
+  explicit Reducer(const BigInt& mod);
+
+ private:
+  friend class BigInt;
+  BigInt mod_;
+  // Empty for moduli below the Barrett threshold, which use plain %.
+  LimbVector inv_;
+};
+
+// Reads consecutive binary BigInts from a word buffer, such as a file
+// written with BigInt::WriteBinary and mapped with MappedFile.
+class BinaryReader {
+ public:
+  BinaryReader(const uint64_t* data, size_t words)
+      : pos_(data), end_(data + words) {}
+  // Next value as a view into the buffer, or as a copy. Both return false,
+  // leaving the output untouched, once no complete record is left.
+  bool Next(BigIntView* view);
+  bool Next(BigInt* value);
+  // True when every word has been read, i.e. the data was not truncated.
+  bool AtEnd() const { return pos_ == end_; }
+
+ private:
+  const uint64_t* pos_;
+  const uint64_t* end_;
+};
+
+// Read-only memory map of a whole file. A trailing partial word is ignored.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // False if the file could not be opened or mapped.
+  bool IsOpen() const { return open_; }
+  const uint64_t* data() const { return data_; }
+  size_t words() const { return bytes_ / sizeof(uint64_t); }
+  BinaryReader Reader() const { return BinaryReader(data_, words()); }
+
+ private:
+  bool open_ = false;
+  const uint64_t* data_ = nullptr;
+  size_t bytes_ = 0;
 };
@@ -0,0 +1,367 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "big_integer.hpp"
+
+// Signed integer of a fixed width of Bits bits, a positive multiple of 64,
+// in two's complement on a std::array of limbs, least significant first.
+// The value lives in the object, so arithmetic never allocates. All of it is
+// constexpr; the loops run over a compile-time number of limbs, which the
+// compiler unrolls into straight carry chains for the usual widths.
+//
+// The operators mirror BigInt: / truncates toward zero and % takes the sign
+// of the dividend. Results that do not fit wrap around modulo 2^Bits, like
+// the built-in integers, and the conversions to and from BigInt are explicit.
+template <size_t Bits>
+class FixedInt {
+  static_assert(Bits > 0 && Bits % 64 == 0,
+                "FixedInt width must be a positive multiple of 64 bits");
+
+  template <typename T>
+  using IfIntegral = typename std::enable_if<
+      std::is_integral<T>::value && !std::is_same<T, bool>::value,
+      int>::type;
+  template <typename T>
+  using Widened = typename std::conditional<std::is_signed<T>::value,
+                                            int64_t, uint64_t>::type;
+
+ public:
+  static constexpr size_t kLimbs = Bits / 64;
+
+  constexpr FixedInt() : limbs_() {}
+  template <typename T, IfIntegral<T> = 0>
+  constexpr FixedInt(T num) : FixedInt(FromInteger(Widened<T>(num))) {}
+  // Sign-extends or truncates another width.
+  template <size_t OtherBits>
+  constexpr explicit FixedInt(const FixedInt<OtherBits>& other)
+      : FixedInt(Resize(other.Limbs())) {}
+  // The low Bits bits of value in two's complement.
+  explicit FixedInt(const BigInt& value);
+  explicit operator BigInt() const;
+
+  constexpr const std::array<uint64_t, kLimbs>& Limbs() const {
+    return limbs_;
+  }
+  std::string ToString() const { return static_cast<BigInt>(*this).ToString(); }
+
+  constexpr FixedInt operator+() const { return *this; }
+  constexpr FixedInt operator-() const { return FixedInt() - *this; }
+  constexpr explicit operator bool() const {
+    for (size_t i = 0; i < kLimbs; ++i) {
+      if (limbs_[i] != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  friend constexpr FixedInt operator+(const FixedInt& lhs,
+                                      const FixedInt& rhs) {
+    Raw res{};
+    uint64_t carry = 0;
+    for (size_t i = 0; i < kLimbs; ++i) {
+      uint64_t sum = lhs.limbs_[i] + carry;
+      carry = sum < carry ? 1 : 0;
+      res.v[i] = sum + rhs.limbs_[i];
+      carry += res.v[i] < sum ? 1 : 0;
+    }
+    return FixedInt(res);
+  }
+  friend constexpr FixedInt operator-(const FixedInt& lhs,
+                                      const FixedInt& rhs) {
+    Raw res{};
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < kLimbs; ++i) {
+      uint64_t diff = lhs.limbs_[i] - rhs.limbs_[i];
+      uint64_t next = lhs.limbs_[i] < rhs.limbs_[i] ? 1 : 0;
+      res.v[i] = diff - borrow;
+      borrow = next | (diff < borrow ? 1 : 0);
+    }
+    return FixedInt(res);
+  }
+  // Only the low kLimbs limbs of the product are formed.
+  friend constexpr FixedInt operator*(const FixedInt& lhs,
+                                      const FixedInt& rhs) {
+    Raw res{};
+    for (size_t i = 0; i < kLimbs; ++i) {
+      uint64_t carry = 0;
+      for (size_t j = 0; i + j < kLimbs; ++j) {
+        Uint128 cur = static_cast<Uint128>(lhs.limbs_[i]) * rhs.limbs_[j] +
+                      res.v[i + j] + carry;
+        res.v[i + j] = static_cast<uint64_t>(cur);
+        carry = static_cast<uint64_t>(cur >> 64);
+      }
+    }
+    return FixedInt(res);
+  }
+  friend constexpr FixedInt operator/(const FixedInt& left,
+                                      const FixedInt& right) {
+    FixedInt quotient;
+    FixedInt remainder;
+    DivMod(left, right, &quotient, &remainder);
+    return quotient;
+  }
+  friend constexpr FixedInt operator%(const FixedInt& left,
+                                      const FixedInt& right) {
+    FixedInt quotient;
+    FixedInt remainder;
+    DivMod(left, right, &quotient, &remainder);
+    return remainder;
+  }
+  // Truncating division: the remainder takes the sign of left.
+  friend constexpr void DivMod(const FixedInt& left, const FixedInt& right,
+                               FixedInt* quotient, FixedInt* remainder) {
+    if (!right) {
+      std::cout << "-1!\n";
+      *remainder = left;
+      *quotient = FixedInt();
+      return;
+    }
+    bool left_neg = left.IsNegative();
+    bool right_neg = right.IsNegative();
+    // The magnitude of the most negative value is its own bit pattern read
+    // as unsigned, so these are exact.
+    Raw quot{};
+    Raw rem{};
+    DivModAbs(ToRaw(left_neg ? -left : left), ToRaw(right_neg ? -right : right),
+              &quot, &rem);
+    *quotient = left_neg != right_neg ? -FixedInt(quot) : FixedInt(quot);
+    *remainder = left_neg ? -FixedInt(rem) : FixedInt(rem);
+  }
+
+  constexpr FixedInt& operator+=(const FixedInt& rhs) {
+    return *this = *this + rhs;
+  }
+  constexpr FixedInt& operator-=(const FixedInt& rhs) {
+    return *this = *this - rhs;
+  }
+  constexpr FixedInt& operator*=(const FixedInt& rhs) {
+    return *this = *this * rhs;
+  }
+  constexpr FixedInt& operator/=(const FixedInt& rhs) {
+    return *this = *this / rhs;
+  }
+  constexpr FixedInt& operator%=(const FixedInt& rhs) {
+    return *this = *this % rhs;
+  }
+  constexpr FixedInt Square() const { return *this * *this; }
+  constexpr FixedInt& operator++() { return *this += FixedInt(1); }
+  constexpr FixedInt& operator--() { return *this -= FixedInt(1); }
+  constexpr FixedInt operator++(int) {
+    FixedInt res = *this;
+    ++*this;
+    return res;
+  }
+  constexpr FixedInt operator--(int) {
+    FixedInt res = *this;
+    --*this;
+    return res;
+  }
+
+  friend constexpr bool operator<(const FixedInt& lhs, const FixedInt& rhs) {
+    return Compare(lhs, rhs) < 0;
+  }
+  friend constexpr bool operator>(const FixedInt& lhs, const FixedInt& rhs) {
+    return Compare(lhs, rhs) > 0;
+  }
+  friend constexpr bool operator<=(const FixedInt& lhs, const FixedInt& rhs) {
+    return Compare(lhs, rhs) <= 0;
+  }
+  friend constexpr bool operator>=(const FixedInt& lhs, const FixedInt& rhs) {
+    return Compare(lhs, rhs) >= 0;
+  }
+  friend constexpr bool operator==(const FixedInt& lhs, const FixedInt& rhs) {
+    return Compare(lhs, rhs) == 0;
+  }
+  friend constexpr bool operator!=(const FixedInt& lhs, const FixedInt& rhs) {
+    return Compare(lhs, rhs) != 0;
+  }
+
+  friend std::ostream& operator<<(std::ostream& outstream,
+                                  const FixedInt& rhs) {
+    return outstream << static_cast<BigInt>(rhs);
+  }
+  friend std::istream& operator>>(std::istream& input, FixedInt& rhs) {
+    BigInt value;
+    if (input >> value) {
+      rhs = FixedInt(value);
+    }
+    return input;
+  }
+
+ private:
+  using Uint128 = unsigned __int128;
+
+  // Scratch limbs for the constexpr kernels: std::array only gets a
+  // constexpr non-const operator[] in C++17, so results are built in a plain
+  // array and then copied into limbs_.
+  struct Raw {
+    uint64_t v[kLimbs];
+  };
+
+  template <size_t... I>
+  constexpr FixedInt(const Raw& raw, std::index_sequence<I...>)
+      : limbs_{{raw.v[I]...}} {}
+  constexpr explicit FixedInt(const Raw& raw)
+      : FixedInt(raw, std::make_index_sequence<kLimbs>()) {}
+
+  static constexpr Raw FromInteger(int64_t num) {
+    Raw res{};
+    res.v[0] = static_cast<uint64_t>(num);
+    for (size_t i = 1; i < kLimbs; ++i) {
+      res.v[i] = num < 0 ? ~uint64_t{0} : 0;
+    }
+    return res;
+  }
+  static constexpr Raw FromInteger(uint64_t num) {
+    Raw res{};
+    res.v[0] = num;
+    return res;
+  }
+  template <size_t OtherLimbs>
+  static constexpr Raw Resize(const std::array<uint64_t, OtherLimbs>& other) {
+    Raw res{};
+    uint64_t fill = (other[OtherLimbs - 1] >> 63) != 0 ? ~uint64_t{0} : 0;
+    for (size_t i = 0; i < kLimbs; ++i) {
+      res.v[i] = i < OtherLimbs ? other[i] : fill;
+    }
+    return res;
+  }
+  static constexpr Raw ToRaw(const FixedInt& x) {
+    Raw res{};
+    for (size_t i = 0; i < kLimbs; ++i) {
+      res.v[i] = x.limbs_[i];
+    }
+    return res;
+  }
+
+  constexpr bool IsNegative() const { return (limbs_[kLimbs - 1] >> 63) != 0; }
+
+  // Signed comparison: flipping the sign bit of the top limb turns it into
+  // an unsigned one.
+  static constexpr int Compare(const FixedInt& lhs, const FixedInt& rhs) {
+    for (size_t i = kLimbs; i-- > 0;) {
+      uint64_t flip = i == kLimbs - 1 ? uint64_t{1} << 63 : 0;
+      uint64_t a = lhs.limbs_[i] ^ flip;
+      uint64_t b = rhs.limbs_[i] ^ flip;
+      if (a != b) {
+        return a < b ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  static constexpr size_t Length(const Raw& x) {
+    size_t n = kLimbs;
+    while (n > 0 && x.v[n - 1] == 0) {
+      --n;
+    }
+    return n;
+  }
+
+  // Unsigned u = q * v + r for v != 0: one pass of 128-bit divisions for a
+  // single-limb v, Knuth's Algorithm D otherwise.
+  static constexpr void DivModAbs(const Raw& u, const Raw& v, Raw* q,
+                                  Raw* r) {
+    size_t m = Length(u);
+    size_t n = Length(v);
+    if (m < n) {
+      *r = u;
+      return;
+    }
+    if (kLimbs == 1 || n == 1) {
+      Uint128 rem = 0;
+      for (size_t i = m; i-- > 0;) {
+        Uint128 cur = (rem << 64) | u.v[i];
+        q->v[i] = static_cast<uint64_t>(cur / v.v[0]);
+        rem = cur % v.v[0];
+      }
+      r->v[0] = static_cast<uint64_t>(rem);
+      return;
+    }
+    int shift = __builtin_clzll(v.v[n - 1]);
+    uint64_t vn[kLimbs] = {};
+    uint64_t un[kLimbs + 1] = {};
+    for (size_t i = n; i-- > 0;) {
+      vn[i] = v.v[i] << shift;
+      if (shift != 0 && i > 0) {
+        vn[i] |= v.v[i - 1] >> (64 - shift);
+      }
+    }
+    un[m] = shift != 0 ? u.v[m - 1] >> (64 - shift) : 0;
+    for (size_t i = m; i-- > 0;) {
+      un[i] = u.v[i] << shift;
+      if (shift != 0 && i > 0) {
+        un[i] |= u.v[i - 1] >> (64 - shift);
+      }
+    }
+    const Uint128 kBase = static_cast<Uint128>(1) << 64;
+    for (size_t j = m - n + 1; j-- > 0;) {
+      Uint128 num = (static_cast<Uint128>(un[j + n]) << 64) | un[j + n - 1];
+      Uint128 qhat = num / vn[n - 1];
+      Uint128 rhat = num % vn[n - 1];
+      while (qhat >= kBase ||
+             qhat * vn[n - 2] > ((rhat << 64) | un[j + n - 2])) {
+        --qhat;
+        rhat += vn[n - 1];
+        if (rhat >= kBase) {
+          break;
+        }
+      }
+      uint64_t borrow = 0;
+      for (size_t i = 0; i < n; ++i) {
+        Uint128 prod = qhat * vn[i] + borrow;
+        uint64_t low = static_cast<uint64_t>(prod);
+        borrow = static_cast<uint64_t>(prod >> 64) + (un[i + j] < low ? 1 : 0);
+        un[i + j] -= low;
+      }
+      bool negative = un[j + n] < borrow;
+      un[j + n] -= borrow;
+      if (negative) {
+        --qhat;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+          uint64_t sum = un[i + j] + carry;
+          carry = sum < carry ? 1 : 0;
+          un[i + j] = sum + vn[i];
+          carry += un[i + j] < sum ? 1 : 0;
+        }
+        un[j + n] += carry;
+      }
+      q->v[j] = static_cast<uint64_t>(qhat);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      r->v[i] = un[i] >> shift;
+      if (shift != 0) {
+        r->v[i] |= un[i + 1] << (64 - shift);
+      }
+    }
+  }
+
+  std::array<uint64_t, kLimbs> limbs_;
+};
+
+template <size_t Bits>
+constexpr size_t FixedInt<Bits>::kLimbs;
+
+template <size_t Bits>
+FixedInt<Bits>::FixedInt(const BigInt& value) : limbs_() {
+  size_t size = std::min(value.x_.size(), kLimbs);
+  std::copy(value.x_.begin(), value.x_.begin() + size, limbs_.begin());
+  if (value.sign_) {
+    *this = -*this;
+  }
+}
+
+template <size_t Bits>
+FixedInt<Bits>::operator BigInt() const {
+  bool negative = IsNegative();
+  FixedInt abs = negative ? -*this : *this;
+  return BigInt(BigIntView{abs.limbs_.data(), kLimbs, negative});
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Magnitude kernels on spans of 64-bit limbs, least significant limb first,
+// in the spirit of GMP's mpn layer. They never allocate and know nothing of
+// signs. The result r may be the same span as an input that starts at the
+// same address.
+namespace limbs {
+
+// r[0, n) = a[0, n) + b[0, n). Returns the carry.
+uint64_t AddN(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+// r[0, an) = a[0, an) + b[0, bn), an >= bn. Returns the carry.
+uint64_t Add(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+             size_t bn);
+// r[0, n) = a[0, n) + b. Returns the carry.
+uint64_t Add1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+
+// r[0, n) = a[0, n) - b[0, n). Returns the borrow.
+uint64_t SubN(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+// r[0, an) = a[0, an) - b[0, bn), an >= bn. Returns the borrow.
+uint64_t Sub(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b,
+             size_t bn);
+// r[0, n) = a[0, n) - b. Returns the borrow.
+uint64_t Sub1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+
+// Sign of a - b. Leading zero limbs are ignored.
+int Compare(const uint64_t* a, size_t an, const uint64_t* b, size_t bn);
+// Length of a[0, n) without its leading zero limbs.
+size_t Normalize(const uint64_t* a, size_t n);
+
+// r[0, n) = a[0, n) * b. Returns the high limb.
+uint64_t Mul1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+// r[0, n) += a[0, n) * b. Returns the carry limb.
+uint64_t AddMul1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+// r[0, n) -= a[0, n) * b. Returns the borrow limb.
+uint64_t SubMul1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+
+// q[0, n) = a[0, n) / b for b != 0. Returns the remainder. Uses a
+// precomputed reciprocal of b, so there is no hardware division per limb.
+uint64_t DivRem1(uint64_t* q, const uint64_t* a, size_t n, uint64_t b);
+// a[0, n) mod b for b != 0.
+uint64_t Mod1(const uint64_t* a, size_t n, uint64_t b);
+
+}  // namespace limbs